@@ -10,7 +10,6 @@
 //################################### BEGIN DEFINES ##################################
 #define LED_PIN     6  //set the data pin of the led strip
 #define LED_COUNT   10 //set the number of leds
-#define NUM_BUTTONS 10 //set the number of buttons
 #define BRIGHTNESS  25 //set the led brightness (max = 255, good = 125)
 
 //the power switch pin
@@ -28,14 +27,19 @@ static bool power;
 //define the led strip object 
 Adafruit_NeoPixel strip(LED_COUNT, LED_PIN, NEO_GRB + NEO_KHZ800);
 
-//the pins for all of the buttons
-const int buttonInputs[NUM_BUTTONS] = {2, 3, 4, 5, 7, 8, 9, 10, 16, 14};
+//the pins for all of the buttons; the number of buttons follows from this table
+const int buttonInputs[] = {2, 3, 4, 5, 7, 8, 9, 10, 16, 14};
+#define NUM_BUTTONS (int)(sizeof(buttonInputs) / sizeof(buttonInputs[0]))
+
+//the led under each button, reported to the computer in the handshake so it
+//knows which led to flash for which sound
+const int buttonLeds[NUM_BUTTONS] = {9, 0, 8, 1, 7, 2, 6, 3, 5, 4};
 
 //the states of all of the buttons
-int buttonStates[NUM_BUTTONS] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+int buttonStates[NUM_BUTTONS] = {0};
 
 //whether or not this led should be ignored for the idle wave effect (i.e. it is being set by the flash function)
-bool ignore[LED_COUNT] = {false, false, false, false, false, false, false, false, false, false};
+bool ignore[LED_COUNT] = {false};
 
 //initialize the TaskScheduler object
 Scheduler runner;
@@ -83,25 +87,42 @@ void readSerial() {
 //helper function for readSerial();
 //updates the arrays 'buttonStates' and 'ignore'
 void parseSerial(const String& data) {
+  //the computer asks what this board looks like
+  if (data == "?") {
+    sendBoardInfo();
+    return;
+  }
   int idx = 0;
-  for (int i = 0; i < data.length() && idx < NUM_BUTTONS; i++) {
+  for (int i = 0; i < data.length() && idx < LED_COUNT; i++) {
     if (data[i] == '0') {
-      buttonStates[idx] = 0;
+      if (idx < NUM_BUTTONS) buttonStates[idx] = 0;
       ignore[idx] = false;
       idx++;
     } else if (data[i] == '1') {
-      buttonStates[idx] = 1;
+      if (idx < NUM_BUTTONS) buttonStates[idx] = 1;
       ignore[idx] = true;
       idx++;
     }
   }
 }
 
+//answers the handshake: "#BOARD <number of buttons> <led under button 1>,<led under button 2>,..."
+void sendBoardInfo() {
+  String result = String("#BOARD ") + String(NUM_BUTTONS) + String(" ");
+  for (int i = 0; i < NUM_BUTTONS; i++) {
+    result += String(buttonLeds[i]);
+    if (i < NUM_BUTTONS - 1) {
+      result += String(",");
+    }
+  }
+  Serial.println(result);
+}
+
 //called by taskscheduler
 void flashTaskCallback(){
   if(!power) return;
-  static bool cycle[NUM_BUTTONS] = {false, false, false, false, false, false, false, false, false, false};
-  for(int i = 0; i<NUM_BUTTONS;i++){
+  static bool cycle[LED_COUNT] = {false};
+  for(int i = 0; i<LED_COUNT;i++){
     if(ignore[i]){
       if(cycle[i]){
         strip.setPixelColor(i, strip.ColorHSV(0));
@@ -1,6 +1,7 @@
 QT += core gui
 QT += multimedia
 QT += serialport
+QT += network
 
 win32: LIBS += -luser32
 
@@ -16,19 +17,82 @@ CONFIG += c++17
 RC_ICONS = icon.ico
 
 SOURCES += \
+    audiomanager.cpp \
+    configfile.cpp \
+    controlserver.cpp \
+    deviceprotocol.cpp \
     droppablebutton.cpp \
+    importpipeline.cpp \
+    loudnessanalyzer.cpp \
     main.cpp \
+    memorybudget.cpp \
+    nativedecoders.cpp \
+    resampler.cpp \
+    routingdialog.cpp \
+    samplecache.cpp \
+    samplepool.cpp \
+    sampleloader.cpp \
+    serialsource.cpp \
     soundboard.cpp \
-    startuphelp.cpp
+    soundboarddaemon.cpp \
+    soundwatcher.cpp \
+    startuphelp.cpp \
+    startupprofile.cpp \
+    triggersource.cpp
 
 HEADERS += \
+    audiomanager.h \
+    audiosample.h \
+    boardconfig.h \
+    configfile.h \
+    controlserver.h \
+    deviceprotocol.h \
     droppablebutton.h \
+    importpipeline.h \
+    loudnessanalyzer.h \
+    memorybudget.h \
+    mixkernels.h \
+    nativedecoders.h \
+    resampler.h \
+    routingdialog.h \
+    samplecache.h \
+    samplepool.h \
+    sampleloader.h \
+    serialsource.h \
     soundboard.h \
+    soundboarddaemon.h \
     soundboardwidget.h \
-    startuphelp.h
+    soundwatcher.h \
+    spscqueue.h \
+    startuphelp.h \
+    startupprofile.h \
+    triggersource.h
 
-# INCLUDEPATH += $$PWD/libs/portaudio/include
-# LIBS += -L$$PWD/libs/portaudio/lib -lportaudio_x64
+win32: INCLUDEPATH += $$PWD/libs/portaudio/include
+win32: LIBS += -L$$PWD/libs/portaudio/lib -lportaudio_x64
+unix: LIBS += -lportaudio
+
+# MP3 is decoded in-process when libmpg123 is available, otherwise through QAudioDecoder
+unix: packagesExist(libmpg123) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libmpg123
+    DEFINES += HAVE_MPG123
+}
+
+# Keys trigger sounds from any window through evdev on Linux
+linux {
+    SOURCES += evdevsource.cpp
+    HEADERS += evdevsource.h
+}
+
+# MIDI controllers trigger sounds through the ALSA sequencer when libasound is available
+linux: packagesExist(alsa) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += alsa
+    DEFINES += HAVE_ALSA
+    SOURCES += midisource.cpp
+    HEADERS += midisource.h
+}
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
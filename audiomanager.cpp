@@ -1,47 +1,79 @@
 #include "audiomanager.h"
 
+#include <QElapsedTimer>
 #include <QDebug>
 
-#define SAMPLE_RATE 44100
-#define CHANNELS 2
-#define FRAMES_PER_BUFFER 512
-#define LATENCY_THRESHOLD_MS 50 // Maximum acceptable latency before warning
-#define LATENCY_ADJUSTMENT_STEP 0.05 // Gradual buffer size correction
-#define MAX_SAMPLE_VALUE 1.0f // Maximum amplitude for normalization
-#define LATENCY_CORRECTION_FACTOR 0.75 // Reduce buffer size by 25% if latency is too high
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#define DEFAULT_IDLE_TIMEOUT_MS 5000 // Silence period before the engine goes idle
+#define WORKER_INTERVAL_MS 10 // How often the worker services the engine while active
+#define DEFAULT_DUCK_AMOUNT_DB -12.0f // Input attenuation while sounds play
+#define DEFAULT_DUCK_ATTACK_MS 10.0f
+#define DEFAULT_DUCK_RELEASE_MS 300.0f
+#define DEFAULT_GAIN_RAMP_MS 20.0f // Time for any gain change to take full effect
+#define DEFAULT_FADE_MS 10.0f // Fade-out on stop and retrigger
+#define STEAL_FADE_MS 2.0f // Fade-out of a voice stolen from a full bus
+#define STREAM_READAHEAD_BLOCKS 16 // Mapped frames kept resident ahead of a streaming voice, in callback blocks
+#define STREAM_PAGE_FRAMES 512 // Stereo float frames per 4 KiB page
 
 AudioManager::AudioManager(QObject *parent)
-    : QObject(parent), stream(nullptr)
+    : QObject(parent), idleTimeoutMs(DEFAULT_IDLE_TIMEOUT_MS)
 {
-    Pa_Initialize();
-    sharedMixBuffer.resize(FRAMES_PER_BUFFER * CHANNELS, 0.0f);
-    workerThread->start(); // Start audio processing thread
+    for (int i = 0; i < NUM_BUSES; i++) {
+        buses[i].manager = this;
+        buses[i].index = i;
+    }
+    for (int i = 0; i < MAX_SLOTS; i++) {
+        slotVoices[i] = 0;
+        slotGains[i] = 1.0f;
+        trimStarts[i] = 0;
+        trimEnds[i] = 0;
+        for (int bus = 0; bus < NUM_BUSES; bus++)
+            routes[i][bus] = 1.0f;
+    }
+    slotSamples.resize(MAX_SLOTS);
+    setDuckingAmount(DEFAULT_DUCK_AMOUNT_DB);
+    setDuckingTimes(DEFAULT_DUCK_ATTACK_MS, DEFAULT_DUCK_RELEASE_MS);
+    setGainRampTime(DEFAULT_GAIN_RAMP_MS);
+    setFadeTime(DEFAULT_FADE_MS);
+
+    workerThread = new AudioWorker(this);
+    workerThread->start(); // Start the housekeeping thread
 }
 
 AudioManager::~AudioManager(){
     stop();
     workerThread->requestInterruption();
+    {
+        // The worker may be asleep on the wake condition; kick it so it can exit.
+        QMutexLocker locker(&idleMutex);
+        wakeCondition.wakeAll();
+    }
     workerThread->quit();
     workerThread->wait();
+    delete workerThread;
 
-    // Clean up each media player’s resources.
-    QMutexLocker locker(&mutex);
-    for (auto &wrapper : mediaPlayers) {
-        if (wrapper.audioSink) {
-            wrapper.audioSink->stop();
-            delete wrapper.audioSink;
-        }
-        if (wrapper.buffer) {
-            wrapper.buffer->close();
-            delete wrapper.buffer;
-        }
-    }
-    mediaPlayers.clear();
+    QMutexLocker locker(&initMutex);
+    if (paInitialized)
+        Pa_Terminate();
+}
 
-    Pa_Terminate();
+void AudioManager::initialize(){
+    QMutexLocker locker(&initMutex);
+    if (paInitialized)
+        return;
+    const PaError error = Pa_Initialize();
+    if (error != paNoError) {
+        qDebug() << "PortAudio failed to initialize:" << Pa_GetErrorText(error);
+        return;
+    }
+    paInitialized = true;
 }
 
 QStringList AudioManager::getInputDevices() {
+    initialize();
     QStringList devices;
     int numDevices = Pa_GetDeviceCount();
     for (int i = 0; i < numDevices; i++) {
@@ -54,6 +86,7 @@ QStringList AudioManager::getInputDevices() {
 }
 
 QStringList AudioManager::getOutputDevices() {
+    initialize();
     QStringList devices;
     int numDevices = Pa_GetDeviceCount();
     for (int i = 0; i < numDevices; i++) {
@@ -65,101 +98,566 @@ QStringList AudioManager::getOutputDevices() {
     return devices;
 }
 
+int AudioManager::sampleRate() const {
+    return rate.load(std::memory_order_relaxed);
+}
+
+int AudioManager::outputRate(const QString &name){
+    initialize();
+    return deviceRate(name);
+}
+
+// The default rate of the device bus 0 would open on: the one its host API
+// mixes at, or the hardware rate. Bus 0 falls back to the default device.
+int AudioManager::deviceRate(const QString &name) const {
+    const PaDeviceIndex device = name.isEmpty() ? Pa_GetDefaultOutputDevice() : findDevice(name, false, -1);
+    if (device == paNoDevice)
+        return rate.load(std::memory_order_relaxed);
+    const int deviceRate = int(std::lround(Pa_GetDeviceInfo(device)->defaultSampleRate));
+    return deviceRate > 0 ? deviceRate : SAMPLE_RATE;
+}
+
+// Opens and starts one stream per configured bus. Any previously running
+// streams are stopped first, so this is also how device changes are applied.
+// Every bus runs at bus 0's device rate; samples are shared between the buses.
+// Only bus 0 failing stops the engine; another bus that can't be opened is
+// reported and left silent.
 bool AudioManager::start(){
-    PaStreamParameters inputParams, outputParams;
+    initialize();
+    stop();
 
-    inputParams.device = Pa_GetDefaultInputDevice();
-    outputParams.device = Pa_GetDefaultOutputDevice();
+    QStringList errors;
+    bool rateChanged = false;
+    bool mainBusFailed = false;
+    {
+        QMutexLocker locker(&commandMutex);
+        QMutexLocker idleLocker(&idleMutex);
+        const int newRate = deviceRate(buses[0].outputName);
+        if (newRate != rate.load(std::memory_order_relaxed)) {
+            qDebug() << "Audio engine rate" << rate.load() << "->" << newRate;
+            rate.store(newRate, std::memory_order_relaxed);
+            updateTimings();
+            rateChanged = true;
+        }
+        for (Bus &bus : buses) {
+            QString error;
+            if (!openBus(bus, error)) {
+                errors.append(QString("Output %1: %2").arg(bus.index + 1).arg(error));
+                mainBusFailed |= bus.index == 0;
+            }
+        }
+    }
 
-    qDebug()<<"inp: "<<inputParams.device<<" "<<Pa_GetDeviceInfo(inputParams.device)->name;
-    qDebug()<<"out: "<<outputParams.device<<" "<<Pa_GetDeviceInfo(outputParams.device)->name;
+    // Reported outside the locks; receivers load their sounds again.
+    if (rateChanged)
+        emit sampleRateChanged(rate.load());
 
-    if (inputParams.device == paNoDevice || outputParams.device == paNoDevice) {
-        emit errorOccurred("No input or output device available.");
+    // Errors are reported outside the locks; receivers may open dialogs.
+    if (mainBusFailed)
+        stop();
+    for (const QString &error : std::as_const(errors))
+        emit errorOccurred(error);
+    if (mainBusFailed)
         return false;
+
+    emit audioProcessingStarted();
+    return true;
+}
+
+void AudioManager::stop(){
+    bool wasRunning = false;
+    {
+        QMutexLocker locker(&commandMutex);
+        QMutexLocker idleLocker(&idleMutex);
+        for (Bus &bus : buses) {
+            if (!bus.stream)
+                continue;
+            if (!bus.paused)
+                Pa_StopStream(bus.stream);
+            Pa_CloseStream(bus.stream);
+            bus.stream = nullptr;
+            bus.paused = false;
+            wasRunning = true;
+
+            // The callback is gone, so finish its pending commands and voices here.
+            Command command;
+            while (bus.commands.pop(command))
+                applyCommand(bus, command);
+            while (bus.voiceCount > 0)
+                releaseVoice(bus, 0);
+        }
     }
+    if (wasRunning)
+        emit audioProcessingStopped();
+}
 
-    inputParams.channelCount = CHANNELS;
-    inputParams.sampleFormat = paFloat32;
-    inputParams.suggestedLatency = Pa_GetDeviceInfo(inputParams.device)->defaultLowInputLatency;
-    inputParams.hostApiSpecificStreamInfo = nullptr;
+bool AudioManager::isRunning() const {
+    for (const Bus &bus : buses) {
+        if (bus.stream)
+            return true;
+    }
+    return false;
+}
+
+bool AudioManager::openBus(Bus &bus, QString &error){
+    // Bus 0 falls back to the default device; other buses are optional.
+    if (bus.outputName.isEmpty() && bus.index != 0)
+        return true;
 
+    PaStreamParameters outputParams;
+    outputParams.device = bus.outputName.isEmpty() ? Pa_GetDefaultOutputDevice() : findDevice(bus.outputName, false, -1);
+    if (outputParams.device == paNoDevice) {
+        error = QString("Output device \"%1\" is not available.").arg(bus.outputName);
+        return false;
+    }
+    const PaDeviceInfo *outputInfo = Pa_GetDeviceInfo(outputParams.device);
     outputParams.channelCount = CHANNELS;
     outputParams.sampleFormat = paFloat32;
-    outputParams.suggestedLatency = Pa_GetDeviceInfo(outputParams.device)->defaultLowOutputLatency;
+    outputParams.suggestedLatency = outputInfo->defaultLowOutputLatency;
     outputParams.hostApiSpecificStreamInfo = nullptr;
 
-    PaError err = Pa_OpenStream(&stream, &inputParams, &outputParams, SAMPLE_RATE,
-                                FRAMES_PER_BUFFER, paClipOff, audioCallback, this);
-
+    // The mic bus is a duplex stream on bus 0. PortAudio only supports duplex
+    // streams within one host API, so look the input up on the output's API.
+    PaStreamParameters inputParams;
+    bus.hasInput = bus.index == 0 && micBus;
+    bus.inputChannels = 0;
+    if (bus.hasInput) {
+        QString name = inputName;
+        if (name.isEmpty() && Pa_GetDefaultInputDevice() != paNoDevice)
+            name = QString::fromUtf8(Pa_GetDeviceInfo(Pa_GetDefaultInputDevice())->name);
+        inputParams.device = findDevice(name, true, outputInfo->hostApi);
+        if (inputParams.device == paNoDevice) {
+            error = QString("Input device \"%1\" is not available.").arg(name);
+            return false;
+        }
+        const PaDeviceInfo *inputInfo = Pa_GetDeviceInfo(inputParams.device);
+        bus.inputChannels = std::min(CHANNELS, inputInfo->maxInputChannels);
+        inputParams.channelCount = bus.inputChannels;
+        inputParams.sampleFormat = paFloat32;
+        inputParams.suggestedLatency = inputInfo->defaultLowInputLatency;
+        inputParams.hostApiSpecificStreamInfo = nullptr;
+
+        qDebug()<<"bus"<<bus.index<<"inp: "<<inputParams.device<<" "<<inputInfo->name;
+    }
+    qDebug()<<"bus"<<bus.index<<"out: "<<outputParams.device<<" "<<outputInfo->name;
+
+    bus.deviceRate = 0;
+    PaError err = Pa_OpenStream(&bus.stream, bus.hasInput ? &inputParams : nullptr, &outputParams, rate.load(),
+                                FRAMES_PER_BUFFER, paClipOff, audioCallback, &bus);
+
+    // A second output may not run at bus 0's rate (a 48 kHz only headset next
+    // to a 44.1 kHz interface, or a shared-mode device mixing at another rate).
+    // It opens at its own rate and the callback converts the bus' mix.
+    const int ownRate = int(std::lround(outputInfo->defaultSampleRate));
+    if (err != paNoError && bus.index != 0 && !bus.hasInput && ownRate > 0 && ownRate != rate.load()) {
+        qDebug() << "bus" << bus.index << "can't run at" << rate.load() << "Hz:" << Pa_GetErrorText(err)
+                 << "; resampling it to" << ownRate << "Hz";
+        const double step = double(rate.load()) / ownRate;
+        bus.resampled.fill(0.0f, (qint64(std::ceil(FRAMES_PER_BUFFER * step)) + 4) * CHANNELS);
+        bus.resampledFrames = 0;
+        bus.resamplePhase = 0.0;
+        bus.deviceRate = ownRate;
+        err = Pa_OpenStream(&bus.stream, nullptr, &outputParams, ownRate,
+                            FRAMES_PER_BUFFER, paClipOff, audioCallback, &bus);
+    }
     if (err != paNoError) {
-        emit errorOccurred(QString("Failed to open stream: %1").arg(Pa_GetErrorText(err)));
+        bus.deviceRate = 0;
+        bus.stream = nullptr;
+        error = QString("Failed to open stream: %1").arg(Pa_GetErrorText(err));
         return false;
     }
 
-    err = Pa_StartStream(stream);
+    err = Pa_StartStream(bus.stream);
     if (err != paNoError) {
-        emit errorOccurred(QString("Failed to start stream: %1").arg(Pa_GetErrorText(err)));
+        Pa_CloseStream(bus.stream);
+        bus.stream = nullptr;
+        error = QString("Failed to start stream: %1").arg(Pa_GetErrorText(err));
         return false;
     }
 
-    emit audioProcessingStarted();
+    bus.paused = false;
     return true;
 }
 
-void AudioManager::stop(){
-    if (stream) {
-        Pa_StopStream(stream);
-        Pa_CloseStream(stream);
-        stream = nullptr;
-        emit audioProcessingStopped();
+// PortAudio and Qt name devices differently depending on the host API (MME
+// truncates names to 31 characters), so accept a prefix match as well as an
+// exact one, and prefer devices on the requested (or default) host API.
+PaDeviceIndex AudioManager::findDevice(const QString &name, bool input, PaHostApiIndex preferredApi) const {
+    if (preferredApi < 0)
+        preferredApi = Pa_GetDefaultHostApi();
+
+    PaDeviceIndex best = paNoDevice;
+    int bestScore = 0;
+    const int numDevices = Pa_GetDeviceCount();
+    for (int i = 0; i < numDevices; i++) {
+        const PaDeviceInfo *info = Pa_GetDeviceInfo(i);
+        if ((input ? info->maxInputChannels : info->maxOutputChannels) <= 0)
+            continue;
+
+        const QString deviceName = QString::fromUtf8(info->name);
+        int score;
+        if (deviceName == name)
+            score = 2;
+        else if (!deviceName.isEmpty() && (name.startsWith(deviceName) || deviceName.startsWith(name)))
+            score = 1;
+        else
+            continue;
+        if (info->hostApi == preferredApi)
+            score += 4;
+
+        if (score > bestScore) {
+            best = i;
+            bestScore = score;
+        }
     }
+    return best;
 }
 
-void AudioManager::addMediaPlayer(QMediaPlayer *player){
-    QMutexLocker locker(&mutex);
+void AudioManager::setOutputDevice(int bus, const QString &name){
+    if (bus < 0 || bus >= NUM_BUSES)
+        return;
+    QMutexLocker locker(&commandMutex);
+    buses[bus].outputName = name;
+}
+
+void AudioManager::setInputDevice(const QString &name){
+    QMutexLocker locker(&commandMutex);
+    inputName = name;
+}
+
+void AudioManager::setMicBusEnabled(bool enabled){
+    micBus = enabled;
+}
+
+bool AudioManager::micBusEnabled() const {
+    return micBus;
+}
+
+void AudioManager::setInputGain(float gain){
+    inputGain.store(std::max(0.0f, gain), std::memory_order_relaxed);
+}
+
+void AudioManager::setDuckingEnabled(bool enabled){
+    duckEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void AudioManager::setDuckingAmount(float amountDb){
+    duckGain.store(std::pow(10.0f, std::min(0.0f, amountDb) / 20.0f), std::memory_order_relaxed);
+}
+
+void AudioManager::setDuckingTimes(float attackMs, float releaseMs){
+    duckAttackMs.store(attackMs, std::memory_order_relaxed);
+    duckReleaseMs.store(releaseMs, std::memory_order_relaxed);
+    updateTimings();
+}
+
+void AudioManager::setGainRampTime(float ms){
+    gainRampMs.store(std::max(0.0f, ms), std::memory_order_relaxed);
+    updateTimings();
+}
+
+void AudioManager::setFadeTime(float ms){
+    fadeMs.store(std::max(0.0f, ms), std::memory_order_relaxed);
+    updateTimings();
+}
+
+// The times in frames at the current rate. The ducking envelope uses one-pole
+// smoothing coefficients, so it covers ~63% of the distance to its target in
+// the given time.
+void AudioManager::updateTimings(){
+    const float framesPerMs = 0.001f * rate.load(std::memory_order_relaxed);
+    auto coefficient = [framesPerMs](float ms) {
+        return ms <= 0.0f ? 0.0f : std::exp(-1.0f / (ms * framesPerMs));
+    };
+    duckAttackCoef.store(coefficient(duckAttackMs.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    duckReleaseCoef.store(coefficient(duckReleaseMs.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    gainRampFrames.store(int(gainRampMs.load(std::memory_order_relaxed) * framesPerMs), std::memory_order_relaxed);
+    fadeFrames.store(int(fadeMs.load(std::memory_order_relaxed) * framesPerMs), std::memory_order_relaxed);
+    stealFadeFrames.store(std::max(1, int(STEAL_FADE_MS * framesPerMs)), std::memory_order_relaxed);
+}
+
+void AudioManager::setBusVolume(int bus, float volume){
+    if (bus < 0 || bus >= NUM_BUSES)
+        return;
+    buses[bus].volume.store(std::max(0.0f, volume), std::memory_order_relaxed);
+}
+
+void AudioManager::setRoute(int slot, int bus, float gain){
+    if (slot < 0 || slot >= MAX_SLOTS || bus < 0 || bus >= NUM_BUSES)
+        return;
+    routes[slot][bus].store(std::max(0.0f, gain), std::memory_order_relaxed);
+}
+
+float AudioManager::route(int slot, int bus) const {
+    if (slot < 0 || slot >= MAX_SLOTS || bus < 0 || bus >= NUM_BUSES)
+        return 0.0f;
+    return routes[slot][bus].load(std::memory_order_relaxed);
+}
+
+void AudioManager::setSlotGain(int slot, float gain){
+    if (slot < 0 || slot >= MAX_SLOTS)
+        return;
+    slotGains[slot].store(std::max(0.0f, gain), std::memory_order_relaxed);
+}
+
+float AudioManager::slotGain(int slot) const {
+    if (slot < 0 || slot >= MAX_SLOTS)
+        return 1.0f;
+    return slotGains[slot].load(std::memory_order_relaxed);
+}
+
+void AudioManager::setTrim(int slot, qint64 start, qint64 end){
+    if (slot < 0 || slot >= MAX_SLOTS)
+        return;
+    trimStarts[slot].store(std::max<qint64>(0, start), std::memory_order_relaxed);
+    trimEnds[slot].store(std::max<qint64>(0, end), std::memory_order_relaxed);
+}
+
+// Replaces the sound assigned to a slot. Voices already playing the old sample
+// keep it until they finish; the worker frees it afterwards.
+void AudioManager::setSample(int slot, SamplePtr sample){
+    if (slot < 0 || slot >= MAX_SLOTS)
+        return;
+    QMutexLocker locker(&sampleMutex);
+    if (slotSamples[slot])
+        retiredSamples.append(std::move(slotSamples[slot]));
+    slotSamples[slot] = std::move(sample);
+}
+
+// The trim points and gains are written under the sample lock, which play()
+// also holds while it reads them, so the switch is atomic for triggers.
+void AudioManager::setSlots(const QVector<SlotState> &states){
+    QMutexLocker locker(&sampleMutex);
+    for (int slot = 0; slot < std::min<int>(states.size(), MAX_SLOTS); slot++) {
+        const SlotState &state = states[slot];
+        if (slotSamples[slot])
+            retiredSamples.append(std::move(slotSamples[slot]));
+        slotSamples[slot] = state.sample;
+        trimStarts[slot].store(std::max<qint64>(0, state.trimStart), std::memory_order_relaxed);
+        trimEnds[slot].store(std::max<qint64>(0, state.trimEnd), std::memory_order_relaxed);
+        slotGains[slot].store(std::max(0.0f, state.gain), std::memory_order_relaxed);
+    }
+}
+
+SamplePtr AudioManager::sample(int slot) const {
+    if (slot < 0 || slot >= MAX_SLOTS)
+        return nullptr;
+    QMutexLocker locker(&sampleMutex);
+    return slotSamples[slot];
+}
+
+// Starts (or restarts) a slot on every open bus it is routed to.
+void AudioManager::play(int slot, float velocity){
+    if (slot < 0 || slot >= MAX_SLOTS)
+        return;
+
+    QMutexLocker locker(&commandMutex);
+
+    bool routed[NUM_BUSES];
+    int routedBuses = 0;
+    for (int b = 0; b < NUM_BUSES; b++) {
+        routed[b] = buses[b].stream && routes[slot][b].load(std::memory_order_relaxed) > 0.0f;
+        if (routed[b])
+            routedBuses++;
+    }
+
+    // Take the voice references while the sample is guaranteed to be current,
+    // so the worker can never free it between lookup and playback.
+    // The trim points and gain are read under the same lock so they always
+    // belong to that sample, even across a bank switch.
+    const Sample *sample = nullptr;
+    qint64 start, end;
+    float level;
+    {
+        QMutexLocker sampleLocker(&sampleMutex);
+        sample = slotSamples[slot].get();
+        if (!sample)
+            return;
+        sample->voiceRefs.fetch_add(routedBuses, std::memory_order_relaxed);
+        start = trimStarts[slot].load(std::memory_order_relaxed);
+        end = trimEnds[slot].load(std::memory_order_relaxed);
+        level = slotGains[slot].load(std::memory_order_relaxed) * velocity;
+    }
 
-    for (const MediaPlayerWrapper &wrapper : mediaPlayers) {
-        if (wrapper.player == player) {
-            return; //already added
+    // Routed nowhere: report it finished straight away so the LED doesn't stick.
+    if (routedBuses == 0) {
+        QMetaObject::invokeMethod(this, [this, slot](){ emit voiceFinished(slot); }, Qt::QueuedConnection);
+        return;
+    }
+
+    // A full command queue drops the voice on that bus along with its reference.
+    int started = 0;
+    for (int b = 0; b < NUM_BUSES; b++) {
+        if (!routed[b])
+            continue;
+        slotVoices[slot].fetch_add(1, std::memory_order_relaxed);
+        activeVoices.fetch_add(1, std::memory_order_release);
+        if (buses[b].commands.push({Command::Play, slot, sample, start, end, level})) {
+            started++;
+        }
+        else {
+            sample->voiceRefs.fetch_sub(1, std::memory_order_release);
+            slotVoices[slot].fetch_sub(1, std::memory_order_relaxed);
+            activeVoices.fetch_sub(1, std::memory_order_relaxed);
         }
     }
 
-    // Create the QAudioSink and QBuffer.
-    QAudioDevice device = QAudioDevice::defaultOutputDevice();
-    QAudioSink *audioSink = new QAudioSink(device, this);
-    QBuffer *buffer = new QBuffer(this);
-    buffer->open(QIODevice::ReadWrite);
+    // Nothing was queued: it never started, so it is reported finished like an unrouted slot.
+    if (started == 0) {
+        QMetaObject::invokeMethod(this, [this, slot](){ emit voiceFinished(slot); }, Qt::QueuedConnection);
+        return;
+    }
+
+    wake();
+
+    // Outside the lock, so a receiver may trigger again.
+    locker.unlock();
+    emit voiceStarted(slot);
+}
+
+void AudioManager::stopSlot(int slot){
+    if (slot < 0 || slot >= MAX_SLOTS)
+        return;
+    pushCommand({Command::Stop, slot, nullptr, 0, 0, 0.0f});
+}
+
+void AudioManager::stopAll(){
+    pushCommand({Command::StopAll, -1, nullptr, 0, 0, 0.0f});
+}
+
+void AudioManager::pushCommand(const Command &command){
+    QMutexLocker locker(&commandMutex);
+    for (Bus &bus : buses) {
+        if (bus.stream)
+            bus.commands.push(command);
+    }
+}
+
+void AudioManager::setIdleTimeout(int ms){
+    idleTimeoutMs = std::max(0, ms);
+}
 
-    // Start the QAudioSink: it will return a QIODevice* which will write audio data into our buffer.
-    audioSink->start(buffer);
+int AudioManager::idleTimeout() const {
+    return idleTimeoutMs;
+}
 
-    // Assign the QAudioSink to the QMediaPlayer.
-    player->setAudioOutput(audioSink);
+void AudioManager::setIdlePolicy(IdlePolicy p){
+    policy = p;
+}
 
-    MediaPlayerWrapper wrapper;
-    wrapper.player = player;
-    wrapper.audioSink = audioSink;
-    wrapper.buffer = buffer;
-    wrapper.playbackSpeed = 1.0f;
-    mediaPlayers.append(wrapper);
+AudioManager::IdlePolicy AudioManager::idlePolicy() const {
+    return policy;
+}
 
+bool AudioManager::isIdle() const {
+    return idle.load(std::memory_order_relaxed);
 }
 
-void AudioManager::removeMediaPlayer(QMediaPlayer *player){
-    QMutexLocker locker(&mutex);
-    for (int i = 0; i < mediaPlayers.size(); ++i) {
-        if (mediaPlayers[i].player == player) {
-            if (mediaPlayers[i].audioSink) {
-                mediaPlayers[i].audioSink->stop();
-                delete mediaPlayers[i].audioSink;
+AudioManager::WakeupStats AudioManager::wakeupStats() const {
+    WakeupStats stats;
+    stats.workerWakeups = workerWakeups.load(std::memory_order_relaxed);
+    stats.callbacks = callbackCount.load(std::memory_order_relaxed);
+    stats.mixingCallbacks = mixingCallbackCount.load(std::memory_order_relaxed);
+    stats.idleEntries = idleEntries.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// Called by the worker once nothing has played for idleTimeoutMs.
+void AudioManager::enterIdle(){
+    {
+        QMutexLocker locker(&idleMutex);
+        // A trigger may have landed since the worker last looked.
+        if (idle || activeVoices.load(std::memory_order_acquire) > 0)
+            return;
+
+        idle = true;
+        ++idleEntries;
+
+        // Buses carrying the microphone have to keep running.
+        if (policy == IdlePolicy::PauseStream) {
+            for (Bus &bus : buses) {
+                if (bus.stream && !bus.paused && !bus.hasInput) {
+                    Pa_StopStream(bus.stream);
+                    bus.paused = true;
+                }
             }
-            if (mediaPlayers[i].buffer) {
-                mediaPlayers[i].buffer->close();
-                delete mediaPlayers[i].buffer;
+        }
+    }
+
+    qDebug() << "Audio engine idle after" << idleTimeoutMs.load() << "ms of silence";
+    emit idleEntered();
+}
+
+// Returns the engine to full operation. Safe to call from any thread, and cheap
+// when the engine is already awake, so trigger paths call it unconditionally.
+void AudioManager::wake(){
+    QStringList errors;
+    {
+        QMutexLocker locker(&idleMutex);
+        if (!idle)
+            return;
+
+        for (Bus &bus : buses) {
+            if (bus.stream && bus.paused) {
+                PaError err = Pa_StartStream(bus.stream);
+                if (err != paNoError)
+                    errors.append(QString("Failed to resume stream: %1").arg(Pa_GetErrorText(err)));
+                bus.paused = false;
             }
-            mediaPlayers.removeAt(i);
-            break;
+        }
+
+        // Clearing the flag first means the very next callback mixes again.
+        idle = false;
+        wakeCondition.wakeAll();
+    }
+
+    for (const QString &error : std::as_const(errors))
+        emit errorOccurred(error);
+    emit idleLeft();
+}
+
+// Reports slots whose voices have finished on every bus. Worker thread only.
+void AudioManager::drainEvents(){
+    for (Bus &bus : buses) {
+        int slot;
+        while (bus.finished.pop(slot))
+            emit voiceFinished(slot);
+    }
+}
+
+// Frees replaced samples once no voice references them. Worker thread only.
+void AudioManager::collectGarbage(){
+    QVector<SamplePtr> released;
+    {
+        QMutexLocker locker(&sampleMutex);
+        for (qsizetype i = retiredSamples.size() - 1; i >= 0; i--) {
+            if (retiredSamples[i]->voiceRefs.load(std::memory_order_acquire) == 0) {
+                released.append(std::move(retiredSamples[i]));
+                retiredSamples.removeAt(i);
+            }
+        }
+    }
+    // 'released' goes out of scope here, outside the lock.
+}
+
+// Touches the mapped pages just ahead of every streaming voice so the audio
+// thread finds them resident. The window starts past the resident head and
+// covers many blocks, far more than the worker can fall behind between runs.
+// Samples published here stay alive until collectGarbage() on this same
+// thread sees their voiceRefs drop, which happens only after they are
+// unpublished. Worker thread only.
+void AudioManager::readAhead(){
+    volatile float sink = 0.0f;
+    for (Bus &bus : buses) {
+        for (int v = 0; v < MAX_VOICES + VOICE_HEADROOM; v++) {
+            const Sample *sample = bus.streamSamples[v].load(std::memory_order_acquire);
+            if (!sample)
+                continue;
+            const qint64 position = bus.streamPositions[v].load(std::memory_order_relaxed);
+            const qint64 begin = std::max(position, sample->headFrames);
+            const qint64 end = std::min(sample->frames, begin + STREAM_READAHEAD_BLOCKS * FRAMES_PER_BUFFER);
+            for (qint64 f = begin; f < end; f += STREAM_PAGE_FRAMES)
+                sink = sink + sample->mapped[f * CHANNELS];
         }
     }
 }
@@ -173,230 +671,293 @@ int AudioManager::audioCallback(const void *input, void *output,
     Q_UNUSED(timeInfo);
     Q_UNUSED(statusFlags);
 
-    AudioManager *self = static_cast<AudioManager *>(userData);
-    self->processAudio(static_cast<const float *>(input), static_cast<float *>(output), frameCount);
+    Bus *bus = static_cast<Bus *>(userData);
+    if (bus->deviceRate)
+        bus->manager->processResampled(*bus, static_cast<float *>(output), frameCount);
+    else
+        bus->manager->processAudio(*bus, static_cast<const float *>(input), static_cast<float *>(output), frameCount);
     return paContinue;
 }
 
-void AudioManager::processAudio(const float *input, float *output, unsigned long frameCount)
-{
-
-    // First, copy the passthrough (e.g. microphone) audio.
-    for (unsigned long i = 0; i < frameCount * CHANNELS; i++) {
-        output[i] = input[i];
+// A bus on a device running at another rate. The bus is mixed at the engine
+// rate as usual, only as many frames as this block needs, and linearly
+// interpolated to the device's rate; the frames the next block starts from
+// carry over. Only buses without an input get here.
+void AudioManager::processResampled(Bus &bus, float *output, unsigned long frameCount){
+    if (frameCount == 0)
+        return;
+    const double step = double(rate.load(std::memory_order_relaxed)) / bus.deviceRate;
+    const qint64 last = qint64(bus.resamplePhase + (frameCount - 1) * step) + 1;
+    if (last >= bus.resampled.size() / CHANNELS) {
+        //a block larger than the one the stream was opened with
+        std::memset(output, 0, frameCount * CHANNELS * sizeof(float));
+        return;
     }
-    // Then, add the media player audio stored in the shared mix buffer.
-    if (mixBufferMutex.tryLock()) {  // tryLock to avoid blocking the real-time callback
-        if (sharedMixBuffer.size() == frameCount * CHANNELS) {
-            for (unsigned long i = 0; i < frameCount * CHANNELS; i++) {
-                output[i] += sharedMixBuffer[i];
-            }
+    float *mixed = bus.resampled.data();
+    if (last >= bus.resampledFrames) {
+        processAudio(bus, nullptr, mixed + bus.resampledFrames * CHANNELS, last + 1 - bus.resampledFrames);
+        bus.resampledFrames = last + 1;
+    }
+
+    double position = bus.resamplePhase;
+    for (unsigned long f = 0; f < frameCount; f++, position += step) {
+        const qint64 i = qint64(position);
+        const float fraction = float(position - i);
+        for (int ch = 0; ch < CHANNELS; ch++) {
+            const float a = mixed[i * CHANNELS + ch], b = mixed[(i + 1) * CHANNELS + ch];
+            output[f * CHANNELS + ch] = a + (b - a) * fraction;
         }
-        mixBufferMutex.unlock();
     }
 
-    // QMutexLocker locker(&mutex);
+    const qint64 used = std::min(qint64(position), bus.resampledFrames);
+    bus.resamplePhase = position - used;
+    bus.resampledFrames -= used;
+    std::memmove(mixed, mixed + used * CHANNELS, bus.resampledFrames * CHANNELS * sizeof(float));
+}
 
-    // float maxSample = 0.0f;
-    // QVector<float> mixBuffer(frameCount * CHANNELS, 0.0f);
+void AudioManager::processAudio(Bus &bus, const float *input, float *output, unsigned long frameCount)
+{
+    callbackCount.fetch_add(1, std::memory_order_relaxed);
 
-    // for (MediaPlayerWrapper &wrapper : mediaPlayers) {
-    //     if (wrapper.player->isPlaying()) {
-    //         qint64 bufferSize = wrapper.buffer.size();
-    //         int latencyMs = (bufferSize * 1000) / (SAMPLE_RATE * sizeof(float) * CHANNELS);
+    // While idle there is nothing to mix; just forward the input.
+    if (idle.load(std::memory_order_acquire)) {
+        copyInput(bus, input, output, frameCount, 1.0f);
+        return;
+    }
+    mixingCallbackCount.fetch_add(1, std::memory_order_relaxed);
+
+    Command command;
+    while (bus.commands.pop(command))
+        applyCommand(bus, command);
+
+    // First, copy the passthrough (microphone) audio, ducked while a sound plays on any bus.
+    const bool ducking = duckEnabled.load(std::memory_order_relaxed) && playingVoices.load(std::memory_order_relaxed) > 0;
+    copyInput(bus, input, output, frameCount, ducking ? duckGain.load(std::memory_order_relaxed) : 1.0f);
+
+    // Then, add every active voice on this bus: one multiply-accumulate per
+    // voice with its routing and slot gains folded into the bus volume. Only voices
+    // routed to this bus are ever here, so the cost follows the active voices.
+    // Any change of that combined gain becomes a per-sample ramp; the ramped
+    // part and the steady part of the block each run through a branch-free kernel.
+    const float volume = bus.volume.load(std::memory_order_relaxed);
+    const int rampFrames = gainRampFrames.load(std::memory_order_relaxed);
+    const int stopFrames = fadeFrames.load(std::memory_order_relaxed);
+    for (int v = 0; v < bus.voiceCount; ) {
+        Voice &voice = bus.voices[v];
+        const float target = voice.stopping ? 0.0f : routes[voice.slot][bus.index].load(std::memory_order_relaxed)
+                                                     * voice.level * volume;
+        if (target != voice.gain.target)
+            voice.gain.rampTo(target, voice.stopping ? stopFrames : rampFrames);
+
+        // A streaming sample's resident head and its mapping are separate runs.
+        for (qint64 done = 0; done < qint64(frameCount) && voice.position < voice.end; ) {
+            const qint64 frames = std::min({voice.sample->contiguousFrames(voice.position), voice.end - voice.position, qint64(frameCount) - done});
+            const qint64 ramped = std::min(voice.gain.remaining, frames);
+            const float *source = voice.sample->frame(voice.position);
+            float *target = output + done * CHANNELS;
+            mixAccumulateRamp(target, source, voice.gain.value, voice.gain.step, ramped);
+            voice.gain.advance(ramped);
+            mixAccumulate(target + ramped * CHANNELS, source + ramped * CHANNELS, voice.gain.value, (frames - ramped) * CHANNELS);
+            voice.position += frames;
+            done += frames;
+        }
+        bus.streamPositions[v].store(voice.position, std::memory_order_relaxed);
 
-    //         if (latencyMs > LATENCY_THRESHOLD_MS) {
-    //             qWarning() << "High latency detected for player" << wrapper.player
-    //                        << "- Current latency:" << latencyMs << "ms";
+        if (voice.position >= voice.end || (voice.stopping && voice.gain.remaining == 0))
+            releaseVoice(bus, v); // moves the last voice into 'v'
+        else
+            v++;
+    }
+}
 
-    //             // Reduce buffer size dynamically to fix latency
-    //             qint64 newSize = static_cast<qint64>(bufferSize * LATENCY_CORRECTION_FACTOR);
-    //             wrapper.buffer.buffer().resize(newSize);
+// Writes the bus input (or silence) to the output, applying the input gain and
+// the ducking envelope. The envelope moves towards duckTarget sample by sample,
+// so ducking costs one multiply-add per frame and no extra buffering.
+void AudioManager::copyInput(Bus &bus, const float *input, float *output, unsigned long frameCount, float duckTarget){
+    if (!bus.hasInput || !input) {
+        std::memset(output, 0, frameCount * CHANNELS * sizeof(float));
+        return;
+    }
 
-    //             // Adaptive latency correction
-    //             wrapper.playbackSpeed -= LATENCY_ADJUSTMENT_STEP;
-    //             wrapper.playbackSpeed = std::max(0.5f, wrapper.playbackSpeed); // Prevent too slow playback
-    //             wrapper.player->setPlaybackRate(wrapper.playbackSpeed);
-    //         }
+    // The target is fixed for the block, so the direction is too.
+    const float coef = duckTarget < bus.duckEnvelope ? duckAttackCoef.load(std::memory_order_relaxed)
+                                                     : duckReleaseCoef.load(std::memory_order_relaxed);
+    float envelope = bus.duckEnvelope;
+
+    // The input gain ramps like every other gain; the first block after a
+    // stream opens fades the microphone in from silence.
+    const float gainTarget = inputGain.load(std::memory_order_relaxed);
+    if (gainTarget != bus.inputRamp.target)
+        bus.inputRamp.rampTo(gainTarget, gainRampFrames.load(std::memory_order_relaxed));
+    const unsigned long ramped = std::min<qint64>(bus.inputRamp.remaining, frameCount);
+    float gain = bus.inputRamp.value;
+
+    auto copyFrames = [&](unsigned long begin, unsigned long end, float gainStep) {
+        if (bus.inputChannels == CHANNELS) {
+            for (unsigned long f = begin; f < end; f++) {
+                envelope = duckTarget + (envelope - duckTarget) * coef;
+                const float g = gain * envelope;
+                output[f * 2] = input[f * 2] * g;
+                output[f * 2 + 1] = input[f * 2 + 1] * g;
+                gain += gainStep;
+            }
+        }
+        else {
+            // Mono microphones feed both channels.
+            for (unsigned long f = begin; f < end; f++) {
+                envelope = duckTarget + (envelope - duckTarget) * coef;
+                output[f * 2] = output[f * 2 + 1] = input[f] * gain * envelope;
+                gain += gainStep;
+            }
+        }
+    };
+    copyFrames(0, ramped, bus.inputRamp.step);
+    bus.inputRamp.advance(ramped);
+    gain = bus.inputRamp.value;
+    copyFrames(ramped, frameCount, 0.0f);
 
-    //         QByteArray audioData = wrapper.buffer.read(bufferSize);
-    //         float *bufferData = reinterpret_cast<float *>(audioData.data());
+    bus.duckEnvelope = envelope;
+}
 
-    //         // Advanced mixing: Weighted summing with volume preservation
-    //         for (unsigned long i = 0; i < frameCount * CHANNELS; i++) {
-    //             mixBuffer[i] += bufferData[i] / mediaPlayers.size(); // Divide by number of active sources
-    //             maxSample = std::max(maxSample, std::abs(mixBuffer[i]));
-    //         }
+void AudioManager::applyCommand(Bus &bus, const Command &command){
+    switch (command.type) {
+    case Command::Play:
+        // Retriggering a slot fades the old voice out while the new one starts.
+        for (int v = 0; v < bus.voiceCount; v++) {
+            if (bus.voices[v].slot == command.slot && !bus.voices[v].stopping) {
+                stopVoice(bus.voices[v]);
+                break;
+            }
+        }
+        if (bus.voiceCount >= MAX_VOICES)
+            stealVoice(bus);
+        {
+            // The trim points are clamped here, where the sample they apply to is known.
+            const qint64 end = command.end > 0 ? std::min(command.end, command.sample->frames) : command.sample->frames;
+            const qint64 start = std::min(command.start, end);
+            bus.streamPositions[bus.voiceCount].store(start, std::memory_order_relaxed);
+            bus.streamSamples[bus.voiceCount].store(command.sample->streaming() ? command.sample : nullptr, std::memory_order_release);
+            Voice &voice = bus.voices[bus.voiceCount++];
+            voice.sample = command.sample;
+            voice.position = start;
+            voice.end = end;
+            voice.level = command.level;
+            voice.slot = command.slot;
+            voice.stopping = false;
+            voice.order = bus.voicesStarted++;
+            playingVoices.fetch_add(1, std::memory_order_relaxed);
+            voice.gain.reset(routes[command.slot][bus.index].load(std::memory_order_relaxed)
+                             * command.level * bus.volume.load(std::memory_order_relaxed));
+        }
+        break;
+    case Command::Stop:
+        for (int v = 0; v < bus.voiceCount; v++) {
+            if (bus.voices[v].slot == command.slot)
+                stopVoice(bus.voices[v]);
+        }
+        break;
+    case Command::StopAll:
+        for (int v = 0; v < bus.voiceCount; v++)
+            stopVoice(bus.voices[v]);
+        break;
+    }
+}
 
-    //         // Reset buffer to prevent excess growth
-    //         wrapper.buffer.buffer().clear();
-    //         wrapper.buffer.seek(0);
-    //     }
-    // }
+// Makes room on a bus before a voice is started. At most MAX_VOICES play at
+// once: past that the one started longest ago fades out over a couple of ms,
+// in the headroom past MAX_VOICES, rather than being cut off mid-waveform.
+// Only when the headroom is full of fading voices too (a burst of triggers
+// within the fade) is one of those dropped at once.
+void AudioManager::stealVoice(Bus &bus){
+    if (bus.voiceCount == MAX_VOICES + VOICE_HEADROOM) {
+        int victim = 0;
+        for (int v = 1; v < bus.voiceCount; v++) {
+            const Voice &voice = bus.voices[v], &oldest = bus.voices[victim];
+            if (voice.stopping != oldest.stopping ? voice.stopping : voice.order < oldest.order)
+                victim = v;
+        }
+        releaseVoice(bus, victim);
+    }
 
-    // // Normalize if necessary
-    // if (maxSample > MAX_SAMPLE_VALUE) {
-    //     float normalizationFactor = MAX_SAMPLE_VALUE / maxSample;
-    //     for (unsigned long i = 0; i < frameCount * CHANNELS; i++) {
-    //         mixBuffer[i] *= normalizationFactor;
-    //     }
-    // }
+    int playing = 0;
+    int oldest = -1;
+    for (int v = 0; v < bus.voiceCount; v++) {
+        if (bus.voices[v].stopping)
+            continue;
+        playing++;
+        if (oldest < 0 || bus.voices[v].order < bus.voices[oldest].order)
+            oldest = v;
+    }
+    if (playing < MAX_VOICES)
+        return;
+    Voice &voice = bus.voices[oldest];
+    const int frames = stealFadeFrames.load(std::memory_order_relaxed);
+    stopVoice(voice);
+    if (voice.gain.target != 0.0f || voice.gain.remaining == 0 || voice.gain.remaining > frames)
+        voice.gain.rampTo(0.0f, frames);
+}
+
+// Starts a voice's fade-out; it is released once its gain reaches 0.
+void AudioManager::stopVoice(Voice &voice){
+    if (voice.stopping)
+        return;
+    voice.stopping = true;
+    playingVoices.fetch_sub(1, std::memory_order_relaxed);
+}
 
-    // // Apply mixed buffer to output
-    // for (unsigned long i = 0; i < frameCount * CHANNELS; i++) {
-    //     output[i] += mixBuffer[i];
-    // }
+// Drops a voice from a bus. When the slot is no longer playing on any bus,
+// queue it for the worker to report.
+void AudioManager::releaseVoice(Bus &bus, int voice){
+    const Voice released = bus.voices[voice];
+    if (!released.stopping)
+        playingVoices.fetch_sub(1, std::memory_order_relaxed);
+    const int last = --bus.voiceCount;
+    bus.voices[voice] = bus.voices[last];
+
+    // Unpublish before dropping the reference: once the worker sees voiceRefs
+    // reach zero it may free the sample, and it must no longer find it here.
+    bus.streamSamples[voice].store(bus.streamSamples[last].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bus.streamPositions[voice].store(bus.streamPositions[last].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bus.streamSamples[last].store(nullptr, std::memory_order_relaxed);
+
+    released.sample->voiceRefs.fetch_sub(1, std::memory_order_release);
+    if (slotVoices[released.slot].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        bus.finished.push(released.slot);
+    // Decremented last, so the worker never idles with an unreported slot.
+    activeVoices.fetch_sub(1, std::memory_order_release);
 }
 
 // Worker Thread Implementation
 AudioWorker::AudioWorker(AudioManager *manager) : audioManager(manager) {}
 
 void AudioWorker::run(){
+    // Time since a voice was last active; drives the idle transition.
+    QElapsedTimer silence;
+    silence.start();
+
     // Run until the thread is interrupted.
     while (!isInterruptionRequested()) {
-        // Create a local mix buffer (one frame’s worth of samples)
-        QVector<float> localMixBuffer(FRAMES_PER_BUFFER * CHANNELS, 0.0f);
-        int activeSources = 0;
+        audioManager->workerWakeups.fetch_add(1, std::memory_order_relaxed);
 
-        {
-            // Lock the mediaPlayers list for safe access.
-            QMutexLocker locker(&audioManager->mutex);
-            for (auto &wrapper : audioManager->mediaPlayers) {
-                if (wrapper.player->isPlaying()) {
-                    ++activeSources;
-                    qint64 bufferSize = wrapper.buffer->size();
-                    int latencyMs = int((bufferSize * 1000) / (SAMPLE_RATE * sizeof(float) * CHANNELS));
-                    if (latencyMs > LATENCY_THRESHOLD_MS) {
-                        qWarning() << "High latency detected for player" << wrapper.player
-                                   << "- Current latency:" << latencyMs << "ms. Applying correction.";
-                        wrapper.playbackSpeed -= LATENCY_ADJUSTMENT_STEP;
-                        if (wrapper.playbackSpeed < 0.5f)
-                            wrapper.playbackSpeed = 0.5f;
-                        wrapper.player->setPlaybackRate(wrapper.playbackSpeed);
-                    }
-                    QByteArray audioData = wrapper.buffer->read(bufferSize);
-                    // Ensure that we have enough data; otherwise, skip this source.
-                    if (audioData.size() >= int(FRAMES_PER_BUFFER * CHANNELS * sizeof(float))) {
-                        float *bufferData = reinterpret_cast<float *>(audioData.data());
-                        for (unsigned long i = 0; i < FRAMES_PER_BUFFER * CHANNELS; i++) {
-                            // Divide by the number of active sources so that no one source dominates.
-                            localMixBuffer[i] += bufferData[i] / activeSources;
-                        }
-                    }
-                    // Clear the internal QBuffer to prevent buildup and reduce latency.
-                    wrapper.buffer->buffer().clear();
-                    wrapper.buffer->seek(0);
-                }
-            }
-        }
-        // Normalize the mixed buffer if the signal is too high.
-        float maxSample = 0.0f;
-        for (unsigned long i = 0; i < FRAMES_PER_BUFFER * CHANNELS; i++) {
-            maxSample = std::max(maxSample, std::abs(localMixBuffer[i]));
-        }
-        if (maxSample > MAX_SAMPLE_VALUE) {
-            float normalizationFactor = MAX_SAMPLE_VALUE / maxSample;
-            for (unsigned long i = 0; i < FRAMES_PER_BUFFER * CHANNELS; i++) {
-                localMixBuffer[i] *= normalizationFactor;
-            }
+        audioManager->readAhead();
+        audioManager->drainEvents();
+        audioManager->collectGarbage();
+
+        if (audioManager->activeVoices.load(std::memory_order_acquire) > 0) {
+            silence.restart();
         }
-        // Update the shared mix buffer (used by the audio callback)
-        {
-            QMutexLocker locker(&audioManager->mixBufferMutex);
-            audioManager->sharedMixBuffer = localMixBuffer;
+        else if (silence.elapsed() >= audioManager->idleTimeoutMs) {
+            audioManager->drainEvents();
+            audioManager->enterIdle();
+
+            // Sleep until wake() is called; no timed polling while idle.
+            QMutexLocker locker(&audioManager->idleMutex);
+            while (audioManager->idle && !isInterruptionRequested())
+                audioManager->wakeCondition.wait(&audioManager->idleMutex);
+            silence.restart();
+            continue;
         }
-        msleep(10); // Sleep a short time to reduce CPU load
-    }
-}
-
-QString AudioManager::intToString(int n){
-    switch (n){
-    case 0:
-        return "0";
-    case 1:
-        return "1";
-    case 2:
-        return "2";
-    case 3:
-        return "3";
-    case 4:
-        return "4";
-    case 5:
-        return "5";
-    case 6:
-        return "6";
-    case 7:
-        return "7";
-    case 8:
-        return "8";
-    case 9:
-        return "9";
-    case 10:
-        return "10";
-    default:
-        return "-1";
-
-
-    }
-}
-
-// bool AudioManager::startLoopback(int inputDeviceIndex, int outputDeviceIndex) {
-//     if (stream) {
-//         emit errorOccurred("Audio loopback is already running.");
-//         return false;
-//     }
-
-//     PaStreamParameters inputParams, outputParams;
-//     inputParams.device = inputDeviceIndex;
-//     outputParams.device = outputDeviceIndex;
-
-//     //get device information so we can set the appropriate channel count.
-//     const PaDeviceInfo *inputInfo = Pa_GetDeviceInfo(inputParams.device);
-//     const PaDeviceInfo *outputInfo = Pa_GetDeviceInfo(outputParams.device);
-//     channels = std::min(inputInfo->maxInputChannels, outputInfo->maxOutputChannels);
-//     if (channels <= 0) {
-//         emit errorOccurred("Invalid number of channels available for loopback.");
-//         qDebug()<<"Channels: "<<channels;
-//         return false;
-//     }
-
-//     inputParams.channelCount = channels;
-//     inputParams.sampleFormat = paFloat32;
-//     inputParams.suggestedLatency = inputInfo->defaultLowInputLatency;
-//     inputParams.hostApiSpecificStreamInfo = nullptr;
-
-//     outputParams.channelCount = channels;
-//     outputParams.sampleFormat = paFloat32;
-//     outputParams.suggestedLatency = outputInfo->defaultLowOutputLatency;
-//     outputParams.hostApiSpecificStreamInfo = nullptr;
-
-//     qDebug()<<"input index: "<<inputDeviceIndex<<"name: "<<inputInfo->name;
-//     qDebug()<<"output index: "<<outputDeviceIndex<<"name: "<<outputInfo->name;
-
-//     PaError openErrCode = Pa_OpenStream(&stream, &inputParams, &outputParams, SAMPLE_RATE,
-//                                         FRAMES_PER_BUFFER, paClipOff, audioCallback, this);
-//     if (openErrCode != paNoError) {
-//         qDebug()<<"Err: "<<openErrCode<<"Text: "<<Pa_GetErrorText(openErrCode);
-//         emit errorOccurred("Failed to open audio stream. Error: "+intToString(openErrCode));
-//         return false;
-//     }
-
-//     PaError startErrCode = Pa_StartStream(stream);
-//     if (startErrCode != paNoError) {
-//         qDebug()<<"Err: "<<startErrCode<<"Text: "<<Pa_GetErrorText(startErrCode);
-//         emit errorOccurred("Failed to start audio stream. Error: "+intToString(startErrCode));
-//         return false;
-//     }
-
-//     emit audioLoopbackStarted();
-//     return true;
-// }
-
-// void AudioManager::stopLoopback() {
-//     if (stream) {
-//         Pa_StopStream(stream);
-//         Pa_CloseStream(stream);
-//         stream = nullptr;
-//         emit audioLoopbackStopped();
-//     }
-// }
+
+        msleep(WORKER_INTERVAL_MS); // Sleep a short time to reduce CPU load
+    }
+}
@@ -1,22 +1,36 @@
 #ifndef AUDIOMANAGER_H
 #define AUDIOMANAGER_H
 
+#include "audiosample.h"
+#include "mixkernels.h"
+#include "spscqueue.h"
+
 #include <portaudio.h>
 
-#include <QAudioBufferOutput>
-#include <QMediaPlayer>
-#include <QAudioOutput>
-#include <QAudioFormat>
-#include <QAudioDevice>
-#include <QAudioSink>
-#include <QBuffer>
+#include <QWaitCondition>
+#include <QStringList>
 #include <QVector>
 #include <QObject>
 #include <QThread>
 #include <QMutex>
 
+#include <atomic>
+
+#define SAMPLE_RATE 44100 // Engine rate until the streams are opened on a device
+#define CHANNELS 2
+#define FRAMES_PER_BUFFER 512
+#define NUM_BUSES 2     // Output 1 (call / mic bus) and Output 2 (monitor)
+#define MAX_SLOTS 64    // Highest number of sound slots the engine can address
+#define MAX_VOICES 64   // Simultaneous voices per bus
+#define VOICE_HEADROOM 16 // Extra voices per bus for stolen ones still fading out
+
 class AudioWorker;
 
+// The PortAudio mixing engine.
+// Each output bus has its own stream and callback which mixes every active
+// voice into the device buffer. Bus 0 can optionally be opened as a duplex
+// stream so a microphone is mixed with the sounds in the same callback
+// (the "mic bus"), which replaces an external virtual mixer chain.
 class AudioManager : public QObject
 {
     Q_OBJECT
@@ -24,28 +38,176 @@ public:
     explicit AudioManager(QObject *parent = nullptr);
     ~AudioManager();
 
-    QMutex mutex;
-    QMutex mixBufferMutex;   // protects sharedMixBuffer
-    QVector<float> sharedMixBuffer;
+    // What the engine does with the PortAudio stream once it has gone idle.
+    // SilentCallback keeps the stream running with a callback that only forwards
+    // the input, so the next trigger is heard within one buffer. PauseStream stops
+    // the stream entirely (zero wakeups) at the cost of a stream restart on wake.
+    enum class IdlePolicy {
+        SilentCallback,
+        PauseStream
+    };
+
+    // Counters used to measure how often the engine wakes the CPU.
+    struct WakeupStats {
+        quint64 workerWakeups = 0;   // AudioWorker loop iterations
+        quint64 callbacks = 0;       // PortAudio callbacks (all)
+        quint64 mixingCallbacks = 0; // PortAudio callbacks that did mixing work
+        quint64 idleEntries = 0;     // times the engine went idle
+    };
+
+    // Initializes PortAudio, which enumerates every host API and device and can
+    // take a while. Done by whatever needs it first; it may be called ahead of
+    // time from another thread so that the first start() doesn't wait on it.
+    void initialize();
 
     QStringList getInputDevices();
     QStringList getOutputDevices();
+
+    // The rate the streams run at, which every sample has to be converted to.
+    // start() opens every bus at the default rate of bus 0's device, so the
+    // device never resamples; sampleRateChanged() reports when that moves it.
+    // Another bus whose device won't run at that rate opens at its own and is
+    // resampled in its callback.
+    int sampleRate() const;
+    // The rate the streams would run at with 'name' as bus 0's device.
+    int outputRate(const QString &name);
+
     bool start();
     void stop();
-    void addMediaPlayer(QMediaPlayer *player);
-    void removeMediaPlayer(QMediaPlayer *player);
+    bool isRunning() const;
+
+    // Device and bus setup. Device changes take effect on the next start().
+    void setOutputDevice(int bus, const QString &name);
+    void setInputDevice(const QString &name);
+    void setMicBusEnabled(bool enabled);
+    bool micBusEnabled() const;
+    void setInputGain(float gain);
+    void setBusVolume(int bus, float volume);
+
+    // Sidechain ducking: while any sound plays, on either output, the input is
+    // attenuated by 'amountDb', following the attack and release times. Voices
+    // fading out after a stop no longer hold it down.
+    void setDuckingEnabled(bool enabled);
+    void setDuckingAmount(float amountDb);
+    void setDuckingTimes(float attackMs, float releaseMs);
+
+    // Every gain change (bus volume, routing, input gain) is ramped per sample
+    // over the ramp time. Stopping or retriggering a voice fades it out over
+    // the fade time instead of cutting it off mid-waveform.
+    void setGainRampTime(float ms);
+    void setFadeTime(float ms);
+
+    // Routing matrix: the gain of each slot on each bus, applied on top of the
+    // bus volume. A slot with a zero gain is never started on that bus.
+    void setRoute(int slot, int bus, float gain);
+    float route(int slot, int bus) const;
+
+    // Static gain of a slot on every bus (loudness normalization), applied on
+    // top of its routing gains. A voice keeps the gain it was started with.
+    void setSlotGain(int slot, float gain);
+    float slotGain(int slot) const;
+
+    // Start and end points of a slot, in frames of its sample. Voices start
+    // reading at 'start' and finish at 'end'; an end of 0 plays to the end.
+    void setTrim(int slot, qint64 start, qint64 end);
+
+    // Slots and triggering. Safe to call from any non-audio thread.
+    void setSample(int slot, SamplePtr sample);
+    SamplePtr sample(int slot) const;
+    // 'velocity' scales the voice's gain on top of the slot gain (a MIDI pad
+    // hit softly plays quieter); 1 for plain buttons.
+    void play(int slot, float velocity = 1.0f);
+    void stopSlot(int slot);
+    void stopAll();
+
+    // Everything a slot plays with, so a whole bank can be swapped at once.
+    struct SlotState {
+        SamplePtr sample;
+        qint64 trimStart = 0;
+        qint64 trimEnd = 0;
+        float gain = 1.0f;
+    };
+
+    // Replaces slots 0..states.size()-1 in one step: a trigger sees either all
+    // of the old slots or all of the new ones, never a mix. Voices already
+    // playing keep their samples and gains until they finish.
+    void setSlots(const QVector<SlotState> &states);
+
+    void setIdleTimeout(int ms);
+    int idleTimeout() const;
+    void setIdlePolicy(IdlePolicy policy);
+    IdlePolicy idlePolicy() const;
+    bool isIdle() const;
+    WakeupStats wakeupStats() const;
+
+public slots:
+    void wake();
 
 signals:
     void errorOccurred(const QString &errorMessage);
     void audioProcessingStarted();
     void audioProcessingStopped();
+    void idleEntered();
+    void idleLeft();
+    void sampleRateChanged(int rate);
+    void voiceStarted(int slot);   // any thread: the one that called play()
+    void voiceFinished(int slot);
 
 private:
-    struct MediaPlayerWrapper {
-        QMediaPlayer   *player;
-        QAudioSink     *audioSink;
-        QBuffer        *buffer;
-        float           playbackSpeed = 1.0f;
+    // Sent from the control side to a bus callback.
+    struct Command {
+        enum Type : quint8 { Play, Stop, StopAll };
+        Type type;
+        int slot;
+        const Sample *sample;
+        qint64 start;
+        qint64 end;
+        float level;
+    };
+
+    // A sound playing on one bus. Owned by that bus' audio callback.
+    // A stopping voice is fading out and is released once its gain reaches 0.
+    struct Voice {
+        const Sample *sample;
+        qint64 position;
+        qint64 end;
+        float level;    // slot gain times velocity at trigger time
+        int slot;
+        bool stopping;
+        quint64 order;  // when it was started on its bus; the oldest is stolen first
+        GainRamp gain;
+    };
+
+    struct Bus {
+        AudioManager *manager = nullptr;
+        int index = 0;
+        PaStream *stream = nullptr;
+        QString outputName;
+        bool hasInput = false;
+        int inputChannels = 0;
+        float duckEnvelope = 1.0f;        // audio thread only
+        GainRamp inputRamp;               // audio thread only
+        std::atomic<float> volume{1.0f};
+        std::atomic<bool> paused{false};
+
+        SpscQueue<Command, 256> commands; // control -> callback
+        SpscQueue<int, 256> finished;     // callback -> worker (slot indices)
+
+        Voice voices[MAX_VOICES + VOICE_HEADROOM]; // audio thread only
+        int voiceCount = 0;
+        quint64 voicesStarted = 0;        // audio thread only
+
+        // Published by the callback per voice index for the worker's read-ahead:
+        // the sample if that voice is streaming (else null) and its position.
+        std::atomic<const Sample *> streamSamples[MAX_VOICES + VOICE_HEADROOM] = {};
+        std::atomic<qint64> streamPositions[MAX_VOICES + VOICE_HEADROOM] = {};
+
+        // Set by openBus when the device runs at another rate than the engine:
+        // the bus is mixed into 'resampled' at the engine rate and converted.
+        int deviceRate = 0;               // 0 when the device runs at the engine rate
+        QVector<float> resampled;         // audio thread only once the stream is open
+        qint64 resampledFrames = 0;       // audio thread only; engine frames kept in 'resampled'
+        double resamplePhase = 0.0;       // audio thread only; next output frame, in engine frames
     };
 
     static int audioCallback(const void *input, void *output,
@@ -54,19 +216,90 @@ private:
                              PaStreamCallbackFlags statusFlags,
                              void *userData);
 
-    void processAudio(const float *input, float *output, unsigned long frameCount);
-    // void mixAudio(float *output, unsigned long frameCount);
+    void processAudio(Bus &bus, const float *input, float *output, unsigned long frameCount);
+    void processResampled(Bus &bus, float *output, unsigned long frameCount);
+    void copyInput(Bus &bus, const float *input, float *output, unsigned long frameCount, float duckTarget);
+    void applyCommand(Bus &bus, const Command &command);
+    void stopVoice(Voice &voice);
+    void stealVoice(Bus &bus);
+    void releaseVoice(Bus &bus, int voice);
+    void pushCommand(const Command &command);
+    bool openBus(Bus &bus, QString &error);
+    PaDeviceIndex findDevice(const QString &name, bool input, PaHostApiIndex preferredApi) const;
+    int deviceRate(const QString &name) const;
+    void updateTimings();
+    void enterIdle();
+    void drainEvents();
+    void collectGarbage();
+    void readAhead();
+
+    Bus buses[NUM_BUSES];
 
-    PaStream *stream;
-    QVector<MediaPlayerWrapper> mediaPlayers;
+    // Samples per slot, as seen by the control side, and samples that have been
+    // replaced but may still be referenced by a voice (freed by the worker).
+    mutable QMutex sampleMutex;
+    QVector<SamplePtr> slotSamples;
+    QVector<SamplePtr> retiredSamples;
+
+    std::atomic<float> routes[MAX_SLOTS][NUM_BUSES];
+    std::atomic<float> slotGains[MAX_SLOTS];
+    std::atomic<qint64> trimStarts[MAX_SLOTS];
+    std::atomic<qint64> trimEnds[MAX_SLOTS];
+
+    // Number of buses still playing each slot; reaching zero reports the slot finished.
+    std::atomic<int> slotVoices[MAX_SLOTS];
+    std::atomic<int> activeVoices{0};
+    // Voices on any bus that are playing and not fading out; drives the ducking.
+    std::atomic<int> playingVoices{0};
+
+    // Serializes producers of bus commands. Never taken by the audio callback.
+    QMutex commandMutex;
+
+    QString inputName;
+    std::atomic<bool> micBus{false};
+    std::atomic<float> inputGain{1.0f};
+
+    std::atomic<int> rate{SAMPLE_RATE};
+
+    // The times as set, and what they come to at the current rate.
+    std::atomic<float> duckAttackMs{0.0f};
+    std::atomic<float> duckReleaseMs{0.0f};
+    std::atomic<float> gainRampMs{0.0f};
+    std::atomic<float> fadeMs{0.0f};
+
+    std::atomic<bool> duckEnabled{false};
+    std::atomic<float> duckGain{1.0f};
+    std::atomic<float> duckAttackCoef{0.0f};
+    std::atomic<float> duckReleaseCoef{0.0f};
+
+    std::atomic<int> gainRampFrames{0};
+    std::atomic<int> fadeFrames{0};
+    std::atomic<int> stealFadeFrames{0};
 
     AudioWorker *workerThread = nullptr;
 
-    QString intToString(int);
+    QMutex initMutex;
+    bool paInitialized = false;
+
+    // Idle state. 'idle' is read lock-free by the audio callback; idleMutex guards
+    // the transitions and the wait condition the worker sleeps on while idle.
+    std::atomic<bool> idle{false};
+    std::atomic<int> idleTimeoutMs;
+    std::atomic<IdlePolicy> policy{IdlePolicy::SilentCallback};
+    mutable QMutex idleMutex;
+    QWaitCondition wakeCondition;
+
+    std::atomic<quint64> workerWakeups{0};
+    std::atomic<quint64> callbackCount{0};
+    std::atomic<quint64> mixingCallbackCount{0};
+    std::atomic<quint64> idleEntries{0};
 
     friend class AudioWorker;
 };
 
+// Housekeeping thread for the engine: reads ahead of streaming voices, reports
+// finished voices, frees retired samples and puts the engine to sleep after a
+// period of silence.
 class AudioWorker : public QThread
 {
     Q_OBJECT
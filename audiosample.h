@@ -0,0 +1,44 @@
+#ifndef AUDIOSAMPLE_H
+#define AUDIOSAMPLE_H
+
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+// A fully decoded sound, stored as interleaved stereo float frames.
+// Samples are shared between the control side (which owns them through
+// SamplePtr) and the audio callback (which only ever sees a raw pointer).
+// voiceRefs counts the voices currently reading the sample, so a replaced
+// sample is only released once the audio thread has let go of it.
+// The frames either live in 'data' or, for a sample served from the on-disk
+// cache, in a read-only memory mapping that 'mapping' keeps alive. A mapped
+// sample streams: its first 'headFrames' frames are also copied into 'data'
+// so a trigger starts from RAM, and the audio engine reads the rest of the
+// mapping ahead of each voice so the audio thread never waits on the disk.
+struct Sample
+{
+    QVector<float> data;
+    const float *mapped = nullptr;
+    std::shared_ptr<void> mapping;
+    qint64 headFrames = 0;
+    qint64 frames = 0;
+    int sampleRate = 0;
+
+    mutable std::atomic<int> voiceRefs{0};
+
+    bool streaming() const { return mapped != nullptr; }
+
+    const float *frame(qint64 index) const {
+        return (index < headFrames || !mapped ? data.constData() : mapped) + index * 2;
+    }
+
+    //frames readable from frame(index) in one run (the head and the mapping are separate)
+    qint64 contiguousFrames(qint64 index) const {
+        return index < headFrames ? headFrames - index : frames - index;
+    }
+};
+
+using SamplePtr = std::shared_ptr<Sample>;
+
+#endif // AUDIOSAMPLE_H
@@ -0,0 +1,43 @@
+#ifndef BOARDCONFIG_H
+#define BOARDCONFIG_H
+
+#include "importpipeline.h"
+
+#include <QList>
+
+// What a configuration comes to where it leaves something out, and the helpers
+// both the window and the daemon read one with, so the two always agree.
+
+constexpr char GLOBAL_PROGRAM_VERSION[] = "1.0.1";
+
+//the rate the board's serial link runs at
+constexpr int BOARD_BAUD_RATE = 115200;
+
+//slots shown until a device or a config says otherwise (the original ten-button board)
+constexpr int DEFAULT_SLOT_COUNT = 10;
+//the led under each of those slots: 1 → 10, 2 → 1, 3 → 9, 4 → 2, ... (counting from 1)
+const QList<int> DEFAULT_SLOT_LEDS = {9, 0, 8, 1, 7, 2, 6, 3, 5, 4};
+//buttons held together to switch to the previous and next bank (the outer columns, counting from 0)
+const QList<int> DEFAULT_PREV_BANK_BUTTONS = {0, 1};
+const QList<int> DEFAULT_NEXT_BANK_BUTTONS = {8, 9};
+//keys that trigger slots 1, 2, ... from any window (Linux key codes): F13 to
+//F24, which macro pads send and keyboards don't have
+const QList<int> DEFAULT_TRIGGER_KEYS = {183, 184, 185, 186, 187, 188, 189, 190, 191, 192, 193, 194};
+//the MIDI note that triggers slot 1 (C1, where most drum pads start)
+constexpr int DEFAULT_MIDI_BASE_NOTE = 36;
+//what the settings a configuration may leave out come to
+constexpr int DEFAULT_LEVEL = 100; //% for the output volumes, the microphone gain and every route
+constexpr int DEFAULT_DUCK_DEPTH_DB = 12;
+constexpr int DEFAULT_DUCK_ATTACK = 10, DEFAULT_DUCK_RELEASE = 300; //ms
+constexpr int DEFAULT_GAIN_RAMP = 20, DEFAULT_FADE = 10; //ms
+constexpr int DEFAULT_TARGET_LUFS = -16;
+constexpr int DEFAULT_SILENCE_THRESHOLD_DB = -50;
+constexpr int DEFAULT_MEMORY_BUDGET_MB = 256;
+
+//the start and end points (ms) the import pipeline detected for a sound
+inline QList<int> detectedTrim(const ImportPipeline::Result &result) {
+    const int rate = result.sample->sampleRate;
+    return {int(result.trimStart * 1000 / rate), int((result.trimEnd * 1000 + rate - 1) / rate)};
+}
+
+#endif // BOARDCONFIG_H
@@ -0,0 +1,129 @@
+#include "configfile.h"
+#include "startupprofile.h"
+
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QCborValue>
+#include <QCborMap>
+#include <QSaveFile>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDebug>
+
+#include <algorithm>
+
+#define BINARY_FORMAT_VERSION 1 // Bumped whenever the binary layout changes
+#define BENCHMARK_RUNS 20       // Reads per format in benchmark()
+
+static const char BINARY_VERSION_KEY[] = "binaryFormatVersion";
+
+ConfigFile::Format ConfigFile::formatFor(const QString &fileName){
+    return fileName.endsWith(".cbor", Qt::CaseInsensitive) ? Format::Cbor : Format::Json;
+}
+
+// Decodes either format; 'binary' tells which one it was. A binary document is
+// built twice, as a QCborValue and then as the QJsonObject callers get.
+static ConfigFile::Status parse(const QByteArray &data, QJsonObject &document, bool &binary){
+    //the self-describe tag (0xd9d9f7) can't start a JSON document
+    binary = data.startsWith("\xd9\xd9\xf7");
+    if (binary) {
+        QCborParserError error;
+        const QCborValue value = QCborValue::fromCbor(data, &error);
+        if (error.error != QCborError::NoError || !value.isTag() || !value.taggedValue().isMap())
+            return ConfigFile::Status::BadFormat;
+        QCborMap map = value.taggedValue().toMap();
+        const qint64 version = map.value(QLatin1String(BINARY_VERSION_KEY)).toInteger();
+        if (version < 1 || version > BINARY_FORMAT_VERSION)
+            return ConfigFile::Status::BadFormat;
+        map.remove(QLatin1String(BINARY_VERSION_KEY));
+        document = map.toJsonObject();
+        return ConfigFile::Status::Ok;
+    }
+    const QJsonDocument json = QJsonDocument::fromJson(data);
+    if (!json.isObject())
+        return ConfigFile::Status::BadFormat;
+    document = json.object();
+    return ConfigFile::Status::Ok;
+}
+
+static ConfigFile::Status readFile(const QString &fileName, QJsonObject &document, bool &binary, qint64 &bytes){
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return ConfigFile::Status::CannotOpen;
+    const QByteArray data = file.readAll();
+    bytes = data.size();
+    return parse(data, document, binary);
+}
+
+ConfigFile::Status ConfigFile::read(const QString &fileName, QJsonObject &document){
+    QElapsedTimer timer;
+    timer.start();
+    bool binary = false;
+    qint64 bytes = 0;
+    const Status status = readFile(fileName, document, binary, bytes);
+    if (status == Status::Ok)
+        qCDebug(lcTiming) << "Read" << (binary ? "binary" : "JSON") << "config" << fileName << "(" << bytes << "bytes) in"
+                 << timer.nsecsElapsed() / 1000 << "us";
+    else if (status == Status::BadFormat)
+        qDebug() << "Config" << fileName << "is neither a JSON object nor a binary config this version can read";
+    return status;
+}
+
+bool ConfigFile::write(const QString &fileName, const QJsonObject &document){
+    QByteArray data;
+    if (formatFor(fileName) == Format::Cbor) {
+        QCborMap map = QCborMap::fromJsonObject(document);
+        map.insert(QLatin1String(BINARY_VERSION_KEY), BINARY_FORMAT_VERSION);
+        data = QCborValue(QCborKnownTags::Signature, map).toCbor();
+    }
+    else data = QJsonDocument(document).toJson();
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(data);
+    return file.commit();
+}
+
+// A synthetic config shaped like a real one: banks of ten sounds with their
+// trims, plus a routing row per sound.
+void ConfigFile::benchmark(int slots){
+    slots = std::max(1, slots);
+    QJsonObject config;
+    QJsonArray banks, routes;
+    for (int first = 0; first < slots; first += 10) {
+        QJsonArray sounds, trims;
+        for (int i = first; i < std::min(first + 10, slots); ++i) {
+            sounds.append(QString("C:/Users/someone/Music/Soundboard/Library/sound effect %1.wav").arg(i));
+            trims.append(QJsonArray{i % 50, 1000 + i});
+            routes.append(QJsonArray{100, 80});
+        }
+        banks.append(QJsonObject{{"sounds", sounds}, {"trims", trims}});
+    }
+    config["GLOBAL_PROGRAM_VERSION"] = "benchmark";
+    config["sounds"] = banks.first().toObject().value("sounds");
+    config["banks"] = banks;
+    config["routes"] = routes;
+
+    QTemporaryDir directory;
+    for (const QString &name : {QString("benchmark.json"), QString("benchmark.cbor")}) {
+        const QString fileName = directory.filePath(name);
+        if (!write(fileName, config))
+            continue;
+        QElapsedTimer timer;
+        timer.start();
+        QJsonObject loaded;
+        bool binary;
+        qint64 bytes;
+        Status status = Status::Ok;
+        for (int run = 0; run < BENCHMARK_RUNS && status == Status::Ok; ++run)
+            status = readFile(fileName, loaded, binary, bytes);
+        if (status != Status::Ok) {
+            qDebug() << "Benchmark:" << name << "could not be read back";
+            continue;
+        }
+        qDebug() << "Benchmark:" << slots << "slot config as" << name << "(" << QFile(fileName).size() << "bytes):"
+                 << timer.nsecsElapsed() / 1000 / BENCHMARK_RUNS << "us per load";
+    }
+}
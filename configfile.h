@@ -0,0 +1,35 @@
+#ifndef CONFIGFILE_H
+#define CONFIGFILE_H
+
+#include <QJsonObject>
+#include <QString>
+
+// Reads and writes configuration documents in two formats: JSON, for hand
+// editing, and CBOR, a binary encoding of the same document about a third the
+// size. CBOR only saves space: it is decoded into a CBOR tree and then
+// converted to the JSON object the board reads, so it loads somewhat slower
+// than JSON (see --benchmark-config). Writing picks the format from the
+// extension (".cbor" is binary); reading looks at the contents, so either
+// kind loads whatever it is called. Binary files start with the CBOR
+// self-describe tag and carry a format version so later layouts can be told
+// apart.
+class ConfigFile
+{
+public:
+    enum class Format { Json, Cbor };
+    enum class Status { Ok, CannotOpen, BadFormat };
+
+    static Format formatFor(const QString &fileName);
+
+    //read the document in 'fileName' into 'document'
+    static Status read(const QString &fileName, QJsonObject &document);
+
+    //write 'document' to 'fileName' in the format its extension asks for; the
+    //old file is only replaced once the new one is complete
+    static bool write(const QString &fileName, const QJsonObject &document);
+
+    //time loading a config of 'slots' (at least 1) sounds in both formats and log the results
+    static void benchmark(int slots);
+};
+
+#endif // CONFIGFILE_H
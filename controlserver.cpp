@@ -0,0 +1,185 @@
+#include "controlserver.h"
+
+#include <QDebug>
+
+#include <limits>
+
+#define MAX_LINE_BYTES 4096 // A client that sends more than this without a newline is dropped
+#define PROBE_TIMEOUT_MS 100 // Wait for an existing server to answer before its socket counts as stale
+#define MAX_GAIN_PERCENT 200 // Highest gain a route can have, as in the routing editor
+
+ControlServer::ControlServer(AudioManager *audio, QObject *parent)
+    : QObject(parent), audio(audio)
+{
+    thread.setObjectName("ControlServer");
+    context = new QObject;
+    context->moveToThread(&thread);
+    //deferred deletes still run once the thread's event loop has stopped
+    connect(&thread, &QThread::finished, context, &QObject::deleteLater);
+
+    //every start and stop, whatever triggered it, reaches the subscribers from the server thread
+    connect(audio, &AudioManager::voiceStarted, context, [this](int slot){ notify('P', slot); });
+    connect(audio, &AudioManager::voiceFinished, context, [this](int slot){ notify('S', slot); });
+}
+
+ControlServer::~ControlServer(){
+    thread.quit();
+    thread.wait();
+}
+
+bool ControlServer::listen(const QString &name){
+    if (!thread.isRunning())
+        thread.start();
+    bool listening = false;
+    QMetaObject::invokeMethod(context, [this, name, &listening](){ openServer(name, &listening); }, Qt::BlockingQueuedConnection);
+    return listening;
+}
+
+void ControlServer::openServer(const QString &name, bool *listening){
+    delete server;
+    subscribers.clear();
+    server = new QLocalServer(context);
+    //only programs of the same user may connect
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    if (!server->listen(name) && server->serverError() == QAbstractSocket::AddressInUseError) {
+        //the socket of an instance that crashed is left behind but nobody answers on it
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (!probe.waitForConnected(PROBE_TIMEOUT_MS)) {
+            QLocalServer::removeServer(name);
+            server->listen(name);
+        }
+    }
+    *listening = server->isListening();
+    if (!*listening) {
+        qDebug() << "Control server can't listen on" << name << ":" << server->errorString();
+        return;
+    }
+
+    connect(server, &QLocalServer::newConnection, context, [this](){
+        while (QLocalSocket *socket = server->nextPendingConnection()) {
+            connect(socket, &QLocalSocket::readyRead, context, [this, socket](){ readRequests(socket); });
+            connect(socket, &QLocalSocket::disconnected, context, [this, socket](){
+                subscribers.removeOne(socket);
+                socket->deleteLater();
+            });
+        }
+    });
+    qDebug() << "Control server listening on" << server->fullServerName();
+}
+
+void ControlServer::readRequests(QLocalSocket *socket){
+    while (socket->canReadLine()) {
+        const QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+        QList<Request> requests;
+        QByteArray error;
+        if (!parse(line, requests, error)) {
+            socket->write("E " + error + '\n');
+            continue;
+        }
+        for (const Request &request : std::as_const(requests))
+            run(request, socket);
+    }
+    if (socket->bytesAvailable() > MAX_LINE_BYTES) {
+        socket->write("E request too long\n");
+        socket->disconnectFromServer();
+    }
+}
+
+// Nothing runs until the whole line has been checked, so a batch never stops
+// halfway.
+bool ControlServer::parse(const QByteArray &line, QList<Request> &requests, QByteArray &error) const{
+    for (const QByteArray &part : line.split(';')) {
+        const QList<QByteArray> fields = part.simplified().split(' ');
+        if (fields.first().isEmpty())
+            continue;
+
+        //field 'index' as a number counting from 1, up to 'max'; stored counting from 0
+        auto number = [&fields](int index, int max, int &value) {
+            bool ok = false;
+            value = index < fields.size() ? fields[index].toInt(&ok) : 0;
+            if (!ok || value < 1 || value > max)
+                return false;
+            value -= 1;
+            return true;
+        };
+
+        Request request;
+        request.command = fields.first().size() == 1 ? fields.first()[0] : '\0';
+        bool valid = false;
+        switch (request.command) {
+        case 'p':
+            valid = fields.size() == 2 && number(1, MAX_SLOTS, request.slot);
+            break;
+        case 's':
+            valid = fields.size() == 1 || (fields.size() == 2 && number(1, MAX_SLOTS, request.slot));
+            break;
+        case 'g': {
+            bool ok = false;
+            request.percent = fields.value(2).toInt(&ok);
+            valid = ok && request.percent >= 0 && request.percent <= MAX_GAIN_PERCENT && number(1, MAX_SLOTS, request.slot)
+                    && (fields.size() == 3 || (fields.size() == 4 && number(3, NUM_BUSES, request.bus)));
+            break;
+        }
+        case 'b':
+            if (fields.size() == 2 && (fields[1] == "+" || fields[1] == "-")) {
+                request.step = fields[1] == "+" ? 1 : -1;
+                valid = true;
+            }
+            else valid = fields.size() == 2 && number(1, std::numeric_limits<int>::max(), request.bank);
+            break;
+        case 'w':
+            valid = fields.size() == 1;
+            break;
+        }
+        if (!valid) {
+            error = "bad request \"" + part.trimmed() + "\"";
+            return false;
+        }
+        requests.append(request);
+    }
+    return true;
+}
+
+void ControlServer::run(const Request &request, QLocalSocket *socket){
+    switch (request.command) {
+    case 'p':
+        audio->play(request.slot);
+        emit played(request.slot);
+        break;
+    case 's':
+        if (request.slot < 0)
+            audio->stopAll();
+        else
+            audio->stopSlot(request.slot);
+        break;
+    case 'g':
+        for (int bus = 0; bus < NUM_BUSES; bus++) {
+            if (request.bus >= 0 && bus != request.bus)
+                continue;
+            audio->setRoute(request.slot, bus, request.percent / 100.0f);
+            emit gainChanged(request.slot, bus, request.percent);
+        }
+        break;
+    case 'b':
+        if (request.step != 0)
+            emit bankStepRequested(request.step);
+        else
+            emit bankRequested(request.bank);
+        break;
+    case 'w':
+        if (!subscribers.contains(socket))
+            subscribers.append(socket);
+        break;
+    }
+}
+
+void ControlServer::notify(char event, int slot){
+    if (subscribers.isEmpty())
+        return;
+    const QByteArray message = QByteArray(1, event) + ' ' + QByteArray::number(slot + 1) + '\n';
+    for (QLocalSocket *socket : std::as_const(subscribers))
+        socket->write(message);
+}
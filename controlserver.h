@@ -0,0 +1,75 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include "audiomanager.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QList>
+
+#define CONTROL_SERVER_NAME "UsbSoundboard" // Where the window and the daemon listen unless told otherwise
+
+// Lets other programs on this machine (stream deck software, scripts, game
+// hooks) trigger sounds through a local socket. The server runs on a thread
+// of its own and plays and stops sounds straight through the engine, so a
+// busy window never delays a trigger; only what belongs to the window or the
+// daemon (bank switches, and the leds and the config after a change) is
+// passed on through the signals below.
+//
+// Requests are lines of text. Slots, outputs and banks count from 1, as on
+// the board, and several commands on one line separated by ';' form a batch
+// that is checked as a whole before any of it runs:
+//   p <slot>                       play
+//   s [<slot>]                     stop a slot, or every sound
+//   g <slot> <percent> [<output>]  gain (0-200) of a slot on both outputs, or one
+//   b <bank> | b + | b -           switch to a bank, or the next or previous
+//   w                              subscribe to "P <slot>" and "S <slot>" as sounds start and stop
+// A command that works gets no answer; a batch that doesn't is answered with
+// "E <reason>" and none of it runs.
+class ControlServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ControlServer(AudioManager *audio, QObject *parent = nullptr);
+    ~ControlServer();
+
+    //start serving on 'name' (a socket in the temp directory on Unix, a named
+    //pipe on Windows); false if another instance already serves it
+    bool listen(const QString &name);
+
+signals:
+    // Emitted on the server thread; receivers elsewhere get them queued.
+    void played(int slot);
+    void gainChanged(int slot, int bus, int percent);
+    void bankRequested(int bank);
+    void bankStepRequested(int step);
+
+private:
+    struct Request {
+        char command;
+        int slot = -1;
+        int percent = 0;
+        int bus = -1;     // -1: every output
+        int bank = -1;
+        int step = 0;
+    };
+
+    // Server thread only.
+    void openServer(const QString &name, bool *listening);
+    void readRequests(QLocalSocket *socket);
+    bool parse(const QByteArray &line, QList<Request> &requests, QByteArray &error) const;
+    void run(const Request &request, QLocalSocket *socket);
+    void notify(char event, int slot);
+
+    AudioManager *audio;
+    QThread thread;
+    QObject *context;               // lives on 'thread'; owns the server and its sockets
+    QLocalServer *server = nullptr;
+    QList<QLocalSocket *> subscribers;
+};
+
+#endif // CONTROLSERVER_H
@@ -0,0 +1,103 @@
+#include "deviceprotocol.h"
+
+#include <QStringList>
+#include <QDebug>
+
+#include <algorithm>
+
+DeviceProtocol::DeviceProtocol(QObject *parent) : QObject(parent)
+{
+}
+
+void DeviceProtocol::feed(const QString &line){
+    //the state of a button in an earlier scan ('0' if that scan was shorter)
+    auto stateAt = [](const QString &scan, int i) { return i < scan.length() ? scan[i] : QChar('0'); };
+
+    //the device's answer to "?": "#BOARD <buttons> <led under button 1>,<led under button 2>,..."
+    //line noise on connect can garble it: a bad button count drops the report,
+    //a bad led number drops the led table
+    if (line.startsWith("#BOARD")) {
+        qDebug() << "Device reports" << line;
+        const QStringList fields = line.split(' ', Qt::SkipEmptyParts);
+        bool ok = false;
+        const int buttons = fields.size() >= 2 ? fields[1].toInt(&ok) : 0;
+        if (!ok || buttons <= 0) return;
+        QList<int> leds;
+        if (fields.size() >= 3) {
+            for (const QString &field : fields[2].split(',')) {
+                const int led = field.toInt(&ok);
+                if (!ok || led < 0) {
+                    leds.clear();
+                    break;
+                }
+                leds.append(led);
+            }
+        }
+        emit boardReported(buttons, leds);
+        return;
+    }
+
+    //a board that doesn't answer the handshake still tells us how many buttons it has
+    emit buttonsSeen((line.length() + 1) / 2);
+
+    //holding a bank combination switches banks. the combination's buttons stay
+    //silent until they are let go
+    auto held = [&](const QList<int> &combo, const QString &scan) {
+        if (combo.isEmpty()) return false;
+        for (int button : combo) if (stateAt(scan, 2 * button) != '1') return false;
+        return true;
+    };
+    for (int step : {-1, 1}) {
+        const QList<int> &combo = step < 0 ? prevBankButtons : nextBankButtons;
+        if (!held(combo, line) || held(combo, previous)) continue;
+        for (int button : combo) comboButtons.insert(button);
+        emit bankStepRequested(step, combo);
+    }
+    for (auto it = comboButtons.begin(); it != comboButtons.end(); ) {
+        if (stateAt(line, 2 * *it) == '1') ++it;
+        else it = comboButtons.erase(it);
+    }
+
+    //a button counts as pressed once it has read down for two scans after reading up
+    for (int i = 0; i < line.length(); i += 2) {
+        if (comboButtons.contains(i / 2)) continue;
+        if (line[i] == '1' && stateAt(previous, i) == '1' && stateAt(s1, i) == '1' && stateAt(s2, i) == '0')
+            emit buttonPressed(i / 2);
+    }
+    s2 = s1;
+    s1 = previous;
+    previous = line;
+}
+
+void DeviceProtocol::reset(){
+    previous.clear();
+    s1.clear();
+    s2.clear();
+    comboButtons.clear();
+}
+
+void DeviceProtocol::setBankButtons(const QList<int> &previousBank, const QList<int> &nextBank){
+    prevBankButtons = previousBank;
+    nextBankButtons = nextBank;
+}
+
+//the message to the device gets one digit per led
+void DeviceProtocol::setLedTable(const QList<int> &leds){
+    slotLeds = leds;
+    const int ledCount = leds.isEmpty() ? 0 : std::max(0, *std::max_element(leds.begin(), leds.end()) + 1);
+    QStringList states(ledCount, "0");
+    ledMessage = states.join('|') + '\n';
+}
+
+const QList<int> &DeviceProtocol::ledTable() const {
+    return slotLeds;
+}
+
+//a table lookup and one character, however many slots there are
+QString DeviceProtocol::setLed(int slot, bool on){
+    if (slot < 0 || slot >= slotLeds.size()) return QString();
+    const int position = 2 * slotLeds[slot];
+    if (position < 0 || position >= ledMessage.length() - 1) return QString();
+    ledMessage[position] = on ? '1' : '0';
+    return ledMessage;
+}
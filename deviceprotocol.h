@@ -0,0 +1,53 @@
+#ifndef DEVICEPROTOCOL_H
+#define DEVICEPROTOCOL_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QSet>
+
+// The line protocol spoken by the soundboard firmware, shared by the window
+// and the headless daemon. The device sends a line per scan with one digit per
+// button separated by '|' ("0|1|0|..."), and answers "?" with
+// "#BOARD <buttons> <led under button 1>,<led under button 2>,...". Presses
+// are debounced over the last few scans, and holding a bank combination
+// reports a bank step instead of presses for its buttons. The app answers
+// with the state of every led in the same digit format.
+class DeviceProtocol : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DeviceProtocol(QObject *parent = nullptr);
+
+    //handle one line read from the device
+    void feed(const QString &line);
+
+    //forget the earlier scans (a new connection starts from scratch)
+    void reset();
+
+    //the buttons held together to step to the previous and next bank
+    void setBankButtons(const QList<int> &previousBank, const QList<int> &nextBank);
+
+    //which led sits under each slot; every led starts out off
+    void setLedTable(const QList<int> &leds);
+    const QList<int> &ledTable() const;
+
+    //sets the led under 'slot' and returns the message that shows it on the
+    //device; empty if the slot has no led
+    QString setLed(int slot, bool on);
+
+signals:
+    void boardReported(int buttons, const QList<int> &leds); // leds is empty if the device didn't send them
+    void buttonsSeen(int buttons);                           // a scan showed this many buttons
+    void buttonPressed(int button);
+    void bankStepRequested(int step, const QList<int> &buttons); // -1 or +1, and the buttons held for it
+
+private:
+    QList<int> slotLeds;
+    QString ledMessage;           // the state of every led, sent whole on each change
+    QString previous, s1, s2;     // the last three scans, newest first
+    QList<int> prevBankButtons, nextBankButtons;
+    QSet<int> comboButtons;       // buttons held for a bank switch, silent until released
+};
+
+#endif // DEVICEPROTOCOL_H
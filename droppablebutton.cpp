@@ -24,10 +24,10 @@ void DroppableButton::dropEvent(QDropEvent *event) {
             QString extension = fileInfo.suffix().toLower(); //get file extension
 
             //allow only specific audio file types
-            if (extension == "mp3" || extension == "wav" || extension == "ogg") {
+            if (extension == "mp3" || extension == "wav" || extension == "flac" || extension == "ogg") {
                 emit fileDropped(filePath);
             } else {
-                QMessageBox::critical(this, tr("Error"), tr("Invalid file type. (.mp3, .wav, .ogg, ONLY)"));
+                QMessageBox::critical(this, tr("Error"), tr("Invalid file type. (.mp3, .wav, .flac, .ogg, ONLY)"));
             }
         }
     }
@@ -0,0 +1,136 @@
+#include "evdevsource.h"
+
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+#include <linux/input.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+
+#ifndef input_event_sec
+#define input_event_sec time.tv_sec
+#define input_event_usec time.tv_usec
+#endif
+
+#define INPUT_DIR "/dev/input" // Where the kernel's event devices are
+#define EVENTS_PER_READ 64 // Input events read from a device at once
+
+EvdevSource::EvdevSource(TriggerQueue *queue, QObject *parent)
+    : TriggerSource("evdev", queue, parent)
+{
+}
+
+EvdevSource::~EvdevSource(){
+    stop();
+}
+
+void EvdevSource::setKeys(const QList<int> &keys){
+    QMutexLocker locker(&keyMutex);
+    this->keys = keys;
+}
+
+void EvdevSource::run(){
+    //fds[0] ends the thread, fds[1] reports new devices, the rest are devices;
+    //paths[i] is the device behind fds[i]
+    QVector<pollfd> fds;
+    QStringList paths;
+    fds.append({stopFd(), POLLIN, 0});
+    paths.append(QString());
+
+    //udev creates the node first and makes it readable after, so both count
+    const int watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch >= 0 && inotify_add_watch(watch, INPUT_DIR, IN_CREATE | IN_ATTRIB) < 0)
+        qDebug() << "Devices plugged into" << INPUT_DIR << "later won't trigger sounds";
+    fds.append({watch, POLLIN, 0});
+    paths.append(QString());
+
+    const QStringList nodes = QDir(INPUT_DIR).entryList({"event*"}, QDir::System);
+    for (const QString &node : nodes)
+        openDevice(INPUT_DIR "/" + node, fds, paths);
+    qDebug() << "Reading keys from" << fds.size() - 2 << "input devices";
+
+    while (!isInterruptionRequested()) {
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            qDebug() << "Key triggers stopped:" << strerror(errno);
+            break;
+        }
+        if (fds[0].revents)
+            break;
+
+        //walked backwards, so dropping an unplugged device doesn't skip the next one
+        for (int i = fds.size() - 1; i >= 2; i--) {
+            if (!fds[i].revents) continue;
+            input_event events[EVENTS_PER_READ];
+            const ssize_t bytes = ::read(fds[i].fd, events, sizeof(events));
+            if (bytes < 0 && errno == EAGAIN) continue;
+            if (bytes <= 0 || (fds[i].revents & (POLLERR | POLLHUP))) {
+                //unplugged
+                ::close(fds[i].fd);
+                fds.removeAt(i);
+                paths.removeAt(i);
+                continue;
+            }
+
+            QMutexLocker locker(&keyMutex);
+            for (int e = 0; e < int(bytes / sizeof(input_event)); e++) {
+                //1 is a press; releases (0) and auto-repeat (2) don't trigger
+                const input_event &event = events[e];
+                if (event.type != EV_KEY || event.value != 1 || event.code == 0) continue;
+                const int slot = keys.indexOf(event.code);
+                if (slot >= 0)
+                    trigger(slot, 1.0f, qint64(event.input_event_sec) * 1000000000 + qint64(event.input_event_usec) * 1000);
+            }
+        }
+
+        if (fds[1].revents) {
+            alignas(inotify_event) char buffer[4096];
+            ssize_t bytes;
+            while ((bytes = ::read(watch, buffer, sizeof(buffer))) > 0) {
+                for (ssize_t at = 0; at < bytes; ) {
+                    const inotify_event *change = reinterpret_cast<const inotify_event *>(buffer + at);
+                    const QString node = QFile::decodeName(change->len ? change->name : "");
+                    if (node.startsWith("event"))
+                        openDevice(INPUT_DIR "/" + node, fds, paths);
+                    at += sizeof(inotify_event) + change->len;
+                }
+            }
+        }
+    }
+
+    for (int i = 1; i < fds.size(); i++)
+        if (fds[i].fd >= 0) ::close(fds[i].fd);
+}
+
+//opens a device unless it is open already; devices without keys (sensors,
+//the lid switch) are left alone
+void EvdevSource::openDevice(const QString &path, QVector<pollfd> &fds, QStringList &paths){
+    if (paths.contains(path)) return;
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return;
+
+    unsigned long types = 0;
+    if (ioctl(fd, EVIOCGBIT(0, sizeof(types)), &types) < 0 || !(types & (1UL << EV_KEY))) {
+        ::close(fd);
+        return;
+    }
+    //stamp the events on the queue's clock rather than the wall clock
+    int clock = CLOCK_MONOTONIC;
+    ioctl(fd, EVIOCSCLOCKID, &clock);
+#ifdef EVIOCSMASK
+    //only key events wake the thread, not every movement of a mouse or a stick
+    unsigned long keyEvents = 1UL << EV_KEY;
+    input_mask mask = {0, sizeof(keyEvents), quint64(quintptr(&keyEvents))};
+    ioctl(fd, EVIOCSMASK, &mask);
+#endif
+
+    fds.append({fd, POLLIN, 0});
+    paths.append(path);
+}
@@ -0,0 +1,40 @@
+#ifndef EVDEVSOURCE_H
+#define EVDEVSOURCE_H
+
+#include "triggersource.h"
+
+#include <QStringList>
+#include <QVector>
+#include <QMutex>
+#include <QList>
+
+struct pollfd;
+
+// Keyboards, macro pads and gamepads read straight from the kernel
+// (/dev/input/event*), so their keys trigger sounds whichever window has the
+// focus, or with no window at all. Keys keep working for every other program;
+// only presses are read, auto-repeat is ignored. Reading the devices needs
+// the user to be in the "input" group (or a udev rule); devices that can't
+// be opened are skipped. Devices plugged in later are picked up as they
+// appear.
+class EvdevSource : public TriggerSource
+{
+    Q_OBJECT
+public:
+    explicit EvdevSource(TriggerQueue *queue, QObject *parent = nullptr);
+    ~EvdevSource();
+
+    // The Linux key code that triggers each slot; 0 for none. Any thread.
+    void setKeys(const QList<int> &keys);
+
+protected:
+    void run() override;
+
+private:
+    void openDevice(const QString &path, QVector<pollfd> &fds, QStringList &paths);
+
+    QMutex keyMutex;
+    QList<int> keys;
+};
+
+#endif // EVDEVSOURCE_H
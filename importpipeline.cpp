@@ -0,0 +1,89 @@
+#include "importpipeline.h"
+#include "startupprofile.h"
+
+#include <QFileInfo>
+#include <QThread>
+#include <QDebug>
+
+#include <algorithm>
+#include <vector>
+
+ImportPipeline::ImportPipeline(QObject *parent) : QObject(parent)
+{
+    pool.setMaxThreadCount(importThreads());
+}
+
+// Imports and the loudness measurements that follow them run at the same
+// time. Measuring a sound costs about as much as decoding and converting it,
+// so the two pools split every core but one (left to the audio callbacks and
+// the GUI), the larger share going to the imports.
+int ImportPipeline::analysisThreads(){
+    return std::max(1, (QThread::idealThreadCount() - 1) / 2);
+}
+
+int ImportPipeline::importThreads(){
+    return std::max(1, QThread::idealThreadCount() - 1 - analysisThreads());
+}
+
+ImportPipeline::~ImportPipeline(){
+    //the running loads post back to this object; wait for them and drop the rest
+    pool.clear();
+    pool.waitForDone();
+}
+
+// Every task pulls the next file from the pool's shared queue, so a core that
+// finishes a short clip immediately picks up another and no core idles while
+// files remain. Largest files go first so one long decode doesn't start last
+// and leave the batch waiting on it alone.
+void ImportPipeline::submit(const QList<Job> &jobs){
+    if (jobs.isEmpty())
+        return;
+    if (batchDone == batchTotal) {
+        batchTimer.start();
+        batchErrors.clear();
+        batchTotal = batchDone = 0;
+    }
+    batchTotal += jobs.size();
+    emit progress(batchDone, batchTotal);
+
+    //each file's size is looked up once, not on every comparison
+    std::vector<std::pair<qint64, Job>> ordered;
+    ordered.reserve(jobs.size());
+    for (const Job &job : jobs)
+        ordered.emplace_back(QFileInfo(job.path).size(), job);
+    std::stable_sort(ordered.begin(), ordered.end(), [](const auto &a, const auto &b){
+        return a.first > b.first;
+    });
+
+    for (const auto &sized : ordered) {
+        const Job &job = sized.second;
+        pool.start([this, job](){
+            Result result;
+            result.slot = job.slot;
+            result.bank = job.bank;
+            result.path = job.path;
+            result.quality = job.quality;
+            result.sample = SampleLoader::load(job.path, job.residency, job.quality, &result.error);
+            if (result.sample && job.findTrim)
+                SampleLoader::findAudibleRange(*result.sample, job.silenceThresholdDb, result.trimStart, result.trimEnd);
+            QMetaObject::invokeMethod(this, [this, result](){ complete(result); }, Qt::QueuedConnection);
+        });
+    }
+}
+
+bool ImportPipeline::isBusy() const{
+    return batchDone < batchTotal;
+}
+
+void ImportPipeline::complete(const Result &result){
+    if (!result.sample)
+        batchErrors.append(QString("\"%1\": %2").arg(result.path, result.error));
+    emit imported(result);
+
+    batchDone++;
+    emit progress(batchDone, batchTotal);
+    if (batchDone == batchTotal) {
+        qCDebug(lcTiming) << "Imported" << batchTotal << "sounds on" << pool.maxThreadCount() << "threads in" << batchTimer.elapsed() << "ms";
+        emit finished(batchErrors, batchTimer.elapsed());
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef IMPORTPIPELINE_H
+#define IMPORTPIPELINE_H
+
+#include "sampleloader.h"
+
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QThreadPool>
+#include <QObject>
+#include <QString>
+#include <QList>
+
+// Loads sounds off the GUI thread. Every file is one task on a pool that
+// shares the cores with the loudness analysis: decode (or map from the disk
+// cache), rate conversion and silence detection all run there, and the result
+// comes back to the GUI thread through imported(). Jobs submitted while others are still running
+// join the same batch; when the batch drains, finished() reports every error
+// at once.
+class ImportPipeline : public QObject
+{
+    Q_OBJECT
+public:
+    struct Job {
+        int slot = -1;
+        int bank = 0;                   // handed back in the result untouched
+        QString path;
+        SampleLoader::Residency residency = SampleLoader::Residency::Resident;
+        Resampler::Quality quality = SampleLoader::quality(); // of the conversion to the engine rate
+        bool findTrim = false;          // detect the audible range as well
+        float silenceThresholdDb = -50.0f;
+    };
+
+    struct Result {
+        int slot = -1;
+        int bank = 0;
+        QString path;
+        SamplePtr sample;               // nullptr on failure
+        Resampler::Quality quality = SampleLoader::quality(); // the job's, which the disk cache is keyed on
+        qint64 trimStart = -1;          // frames; -1 unless the job asked for them
+        qint64 trimEnd = -1;
+        QString error;
+    };
+
+    explicit ImportPipeline(QObject *parent = nullptr);
+    ~ImportPipeline();
+
+    void submit(const QList<Job> &jobs);
+    bool isBusy() const;
+
+    //threads for the imports and for the loudness analysis of what they load
+    static int importThreads();
+    static int analysisThreads();
+
+signals:
+    void imported(const ImportPipeline::Result &result);
+    void progress(int done, int total);
+    void finished(const QStringList &errors, qint64 elapsedMs);
+
+private:
+    void complete(const Result &result); // GUI thread
+
+    QThreadPool pool;
+    QElapsedTimer batchTimer;
+    QStringList batchErrors;
+    int batchTotal = 0;
+    int batchDone = 0;
+};
+
+#endif // IMPORTPIPELINE_H
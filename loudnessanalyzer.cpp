@@ -0,0 +1,337 @@
+#include "loudnessanalyzer.h"
+#include "importpipeline.h"
+#include "audiomanager.h"
+#include "samplecache.h"
+#include "samplepool.h"
+#include "startupprofile.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCborValue>
+#include <QCborArray>
+#include <QCborMap>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDebug>
+#include <QFile>
+#include <QDir>
+
+#include <algorithm>
+#include <numeric>
+#include <array>
+#include <cmath>
+
+#define GATE_BLOCK_MS 400 // BS.1770 gating block
+#define GATE_STEP_MS 100 // 75 % overlap between blocks
+#define ABSOLUTE_GATE_LUFS -70.0
+#define RELATIVE_GATE_LU -10.0
+#define TRUE_PEAK_CEILING_DB -1.0 // Normalization never pushes a true peak above this
+#define MAX_BOOST_DB 20.0
+#define MAX_CUT_DB 30.0
+#define TP_PHASES 4 // True peak oversampling factor
+#define TP_TAPS 12 // Taps per phase of the interpolator
+#define SIDECAR_SAVE_DELAY_MS 2000 // A batch of imports writes the sidecar once, this long after its last measurement
+
+static constexpr double Pi = 3.14159265358979323846;
+
+namespace {
+
+// Transposed direct form II biquad, run in double so the K-weighting of long
+// quiet passages doesn't drift.
+struct Biquad {
+    double b0, b1, b2, a1, a2;
+    double z1 = 0.0, z2 = 0.0;
+
+    double process(double x){
+        const double y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        return y;
+    }
+};
+
+// The two K-weighting stages (high shelf, then high pass) for any sample rate,
+// from the analog prototypes BS.1770 specifies at 48 kHz.
+void kWeighting(double rate, Biquad &shelf, Biquad &highPass){
+    double K = std::tan(Pi * 1681.974450955533 / rate);
+    const double Q = 0.7071752369554196;
+    const double Vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    const double Vb = std::pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+    shelf = {(Vh + Vb * K / Q + K * K) / a0, 2.0 * (K * K - Vh) / a0, (Vh - Vb * K / Q + K * K) / a0,
+             2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0};
+
+    K = std::tan(Pi * 38.13547087602444 / rate);
+    const double Qh = 0.5003270373238773;
+    a0 = 1.0 + K / Qh + K * K;
+    highPass = {1.0, -2.0, 1.0, 2.0 * (K * K - 1.0) / a0, (1.0 - K / Qh + K * K) / a0};
+}
+
+double toLufs(double power){
+    return -0.691 + 10.0 * std::log10(power);
+}
+
+}
+
+LoudnessAnalyzer::LoudnessAnalyzer(QObject *parent) : QObject(parent)
+{
+    //shares the cores with the imports it follows
+    pool.setMaxThreadCount(ImportPipeline::analysisThreads());
+    loadSidecar();
+
+    saveTimer.setSingleShot(true);
+    saveTimer.setInterval(SIDECAR_SAVE_DELAY_MS);
+    connect(&saveTimer, &QTimer::timeout, this, [this](){
+        pool.start([this](){ saveSidecar(); });
+    });
+}
+
+LoudnessAnalyzer::~LoudnessAnalyzer(){
+    //drop what hasn't started; the running measurements still touch 'results'
+    pool.clear();
+    pool.waitForDone();
+    //whatever the timer hadn't written yet
+    saveSidecar();
+}
+
+void LoudnessAnalyzer::analyze(int slot, const QString &path, SamplePtr sample, Resampler::Quality quality){
+    if (!sample)
+        return;
+
+    pool.start([this, slot, path, sample, quality](){
+        //the cache entry already knows the source's hash; otherwise read the file once
+        QByteArray key = SampleCache::contentKey(path, quality, sample->sampleRate);
+        if (key.isEmpty()) {
+            QFile file(path);
+            if (file.open(QIODevice::ReadOnly))
+                key = SamplePool::hash(file.readAll());
+        }
+
+        Measurement measurement;
+        bool known = false;
+        {
+            QMutexLocker locker(&mutex);
+            auto it = results.constFind(key);
+            if (!key.isEmpty() && it != results.constEnd()) {
+                measurement = *it;
+                known = true;
+            }
+        }
+
+        if (!known) {
+            QElapsedTimer timer;
+            timer.start();
+            measurement = measure(*sample);
+            qCDebug(lcTiming) << "Measured" << path << ":" << measurement.integratedLufs << "LUFS, true peak"
+                     << measurement.truePeakDb << "dBTP in" << timer.elapsed() << "ms";
+            if (!key.isEmpty()) {
+                QMutexLocker locker(&mutex);
+                results.insert(key, measurement);
+                dirty = true;
+            }
+        }
+
+        QMetaObject::invokeMethod(this, [this, slot, path, measurement, known](){
+            if (!known)
+                saveTimer.start();
+            emit measured(slot, path, measurement);
+        }, Qt::QueuedConnection);
+    });
+}
+
+float LoudnessAnalyzer::normalizationGain(const Measurement &measurement, double targetLufs){
+    if (!measurement.valid)
+        return 1.0f;
+    double gainDb = targetLufs - measurement.integratedLufs;
+    gainDb = std::min(gainDb, TRUE_PEAK_CEILING_DB - measurement.truePeakDb);
+    gainDb = std::clamp(gainDb, -MAX_CUT_DB, MAX_BOOST_DB);
+    return float(std::pow(10.0, gainDb / 20.0));
+}
+
+LoudnessAnalyzer::Measurement LoudnessAnalyzer::measure(const Sample &sample){
+    Measurement measurement;
+    if (sample.frames <= 0 || sample.sampleRate <= 0)
+        return measurement;
+    const double loudness = integratedLoudness(sample);
+    const double peak = truePeak(sample);
+    if (!std::isfinite(loudness) || !std::isfinite(peak))
+        return measurement;
+    measurement.integratedLufs = loudness;
+    measurement.truePeakDb = peak;
+    measurement.valid = true;
+    return measurement;
+}
+
+// Mean square of the K-weighted signal per 100 ms step, summed over both
+// channels (weight 1 each), then combined into overlapping 400 ms blocks and
+// gated twice: absolutely at -70 LUFS and relatively 10 LU below the mean of
+// the blocks that passed. Sounds shorter than a block are one block.
+double LoudnessAnalyzer::integratedLoudness(const Sample &sample){
+    Biquad shelf[CHANNELS], highPass[CHANNELS];
+    for (int ch = 0; ch < CHANNELS; ch++)
+        kWeighting(sample.sampleRate, shelf[ch], highPass[ch]);
+
+    const qint64 stepFrames = qint64(sample.sampleRate) * GATE_STEP_MS / 1000;
+    const int stepsPerBlock = GATE_BLOCK_MS / GATE_STEP_MS;
+    QVector<double> steps;
+    steps.reserve(sample.frames / stepFrames + 1);
+
+    double sum = 0.0;
+    qint64 count = 0;
+    for (qint64 i = 0; i < sample.frames; i++) {
+        const float *frame = sample.frame(i);
+        for (int ch = 0; ch < CHANNELS; ch++) {
+            const double y = highPass[ch].process(shelf[ch].process(frame[ch]));
+            sum += y * y;
+        }
+        if (++count == stepFrames) {
+            steps.append(sum / stepFrames);
+            sum = 0.0;
+            count = 0;
+        }
+    }
+
+    QVector<double> blocks;
+    if (steps.size() < stepsPerBlock) {
+        blocks.append((std::accumulate(steps.begin(), steps.end(), 0.0) * stepFrames + sum) / sample.frames);
+    }
+    else {
+        for (qsizetype j = 0; j + stepsPerBlock <= steps.size(); j++)
+            blocks.append(std::accumulate(steps.begin() + j, steps.begin() + j + stepsPerBlock, 0.0) / stepsPerBlock);
+    }
+
+    auto gatedMean = [&](double gateLufs) {
+        double total = 0.0;
+        int passed = 0;
+        for (double power : std::as_const(blocks)) {
+            if (power > 0.0 && toLufs(power) > gateLufs) {
+                total += power;
+                passed++;
+            }
+        }
+        return passed ? total / passed : 0.0;
+    };
+
+    const double absoluteMean = gatedMean(ABSOLUTE_GATE_LUFS);
+    if (absoluteMean <= 0.0)
+        return -HUGE_VAL;
+    const double relativeGate = std::max(ABSOLUTE_GATE_LUFS, toLufs(absoluteMean) + RELATIVE_GATE_LU);
+    const double mean = gatedMean(relativeGate);
+    return mean > 0.0 ? toLufs(mean) : -HUGE_VAL;
+}
+
+// 4x oversampled peak (BS.1770 annex 2): three interpolated points between
+// every pair of samples from a 48-tap Hann-windowed sinc, plus the samples
+// themselves. Catches the inter-sample overs a sample peak misses.
+double LoudnessAnalyzer::truePeak(const Sample &sample){
+    static const auto coefficients = [](){
+        std::array<std::array<float, TP_TAPS>, TP_PHASES> c{};
+        for (int p = 1; p < TP_PHASES; p++) {
+            for (int j = 0; j < TP_TAPS; j++) {
+                //tap j sits this far from the interpolated point, in input samples
+                const double t = j - (TP_TAPS / 2 - 1) - double(p) / TP_PHASES;
+                const double sinc = std::sin(Pi * t) / (Pi * t);
+                const double window = 0.5 * (1.0 + std::cos(Pi * t / (TP_TAPS / 2)));
+                c[p][j] = float(sinc * window);
+            }
+        }
+        return c;
+    }();
+
+    //each channel's last TP_TAPS samples, stored twice so the window is always contiguous
+    float history[CHANNELS][2 * TP_TAPS] = {};
+    int head = 0;
+    float peak = 0.0f;
+    for (qint64 i = 0; i < sample.frames; i++) {
+        const float *frame = sample.frame(i);
+        for (int ch = 0; ch < CHANNELS; ch++) {
+            history[ch][head] = history[ch][head + TP_TAPS] = frame[ch];
+            peak = std::max(peak, std::fabs(frame[ch]));
+        }
+        head = (head + 1) % TP_TAPS;
+        for (int ch = 0; ch < CHANNELS; ch++) {
+            const float *window = history[ch] + head; //oldest first
+            for (int p = 1; p < TP_PHASES; p++) {
+                float y = 0.0f;
+                for (int j = 0; j < TP_TAPS; j++)
+                    y += window[j] * coefficients[p][j];
+                peak = std::max(peak, std::fabs(y));
+            }
+        }
+    }
+    return peak > 0.0f ? 20.0 * std::log10(peak) : -HUGE_VAL;
+}
+
+QString LoudnessAnalyzer::sidecarFile(){
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/loudness.cbor";
+}
+
+// The sidecar is a CBOR map from content key (raw bytes) to
+// [integrated LUFS, true peak dB, valid]; it loads without parsing text or
+// converting hex keys. Earlier versions kept the same data in loudness.json,
+// which is read once if there is no binary sidecar yet.
+void LoudnessAnalyzer::loadSidecar(){
+    QFile file(sidecarFile());
+    if (!file.open(QIODevice::ReadOnly)) {
+        loadLegacySidecar();
+        return;
+    }
+    const QCborMap map = QCborValue::fromCbor(file.readAll()).toMap();
+    QMutexLocker locker(&mutex);
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+        const QCborArray entry = it.value().toArray();
+        if (entry.size() != 3)
+            continue;
+        Measurement measurement;
+        measurement.integratedLufs = entry[0].toDouble();
+        measurement.truePeakDb = entry[1].toDouble();
+        measurement.valid = entry[2].toBool();
+        results.insert(it.key().toByteArray(), measurement);
+    }
+}
+
+void LoudnessAnalyzer::loadLegacySidecar(){
+    QFile file(QFileInfo(sidecarFile()).absolutePath() + "/loudness.json");
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    const QJsonObject object = QJsonDocument::fromJson(file.readAll()).object();
+    QMutexLocker locker(&mutex);
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        const QJsonObject entry = it.value().toObject();
+        Measurement measurement;
+        measurement.integratedLufs = entry["lufs"].toDouble();
+        measurement.truePeakDb = entry["truePeak"].toDouble();
+        measurement.valid = entry["valid"].toBool();
+        results.insert(QByteArray::fromHex(it.key().toLatin1()), measurement);
+    }
+}
+
+// Runs on the pool. The snapshot is taken after the previous write is done,
+// so an older snapshot never replaces a newer one.
+void LoudnessAnalyzer::saveSidecar(){
+    QMutexLocker saveLocker(&saveMutex);
+    QCborMap map;
+    {
+        QMutexLocker locker(&mutex);
+        if (!dirty)
+            return;
+        dirty = false;
+        for (auto it = results.constBegin(); it != results.constEnd(); ++it)
+            map.insert(it.key(), QCborArray{it->integratedLufs, it->truePeakDb, it->valid});
+    }
+
+    QSaveFile file(sidecarFile());
+    if (!QDir().mkpath(QFileInfo(sidecarFile()).absolutePath()) || !file.open(QIODevice::WriteOnly)) {
+        QMutexLocker locker(&mutex);
+        dirty = true;
+        return;
+    }
+    file.write(QCborValue(map).toCbor());
+    if (!file.commit()) {
+        QMutexLocker locker(&mutex);
+        dirty = true;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef LOUDNESSANALYZER_H
+#define LOUDNESSANALYZER_H
+
+#include "audiosample.h"
+#include "resampler.h"
+
+#include <QByteArray>
+#include <QThreadPool>
+#include <QTimer>
+#include <QObject>
+#include <QString>
+#include <QMutex>
+#include <QHash>
+
+// Measures the loudness of sounds in the background so every slot can be
+// played at the same perceived level. Integrated loudness follows ITU-R
+// BS.1770 (K-weighting, 400 ms gated blocks) and the peak is a 4x oversampled
+// true peak. Measurements run on a thread pool, one file per task, and
+// are kept in a binary sidecar (loudness.cbor in the cache directory) keyed
+// by the content hash of the source file, so each file is measured once.
+// New measurements mark the sidecar dirty; it is written on the pool once
+// they stop arriving, and when the analyzer goes away.
+class LoudnessAnalyzer : public QObject
+{
+    Q_OBJECT
+public:
+    struct Measurement {
+        double integratedLufs = 0.0;
+        double truePeakDb = 0.0;
+        bool valid = false; // false for digital silence
+    };
+
+    explicit LoudnessAnalyzer(QObject *parent = nullptr);
+    ~LoudnessAnalyzer();
+
+    //measure 'sample' (decoded from 'path' with 'quality') for 'slot' without blocking; emits measured() on this thread
+    void analyze(int slot, const QString &path, SamplePtr sample, Resampler::Quality quality);
+
+    //gain (linear) that brings 'measurement' to 'targetLufs' without its true peak exceeding -1 dBTP
+    static float normalizationGain(const Measurement &measurement, double targetLufs);
+
+    //the measurement itself; safe on any thread, reads every frame
+    static Measurement measure(const Sample &sample);
+
+signals:
+    void measured(int slot, const QString &path, LoudnessAnalyzer::Measurement measurement);
+
+private:
+    static double integratedLoudness(const Sample &sample);
+    static double truePeak(const Sample &sample);
+    static QString sidecarFile();
+    void loadSidecar();
+    void loadLegacySidecar();
+    void saveSidecar();
+
+    QThreadPool pool;
+    QTimer saveTimer;
+    QMutex saveMutex; // one write of the sidecar at a time
+    QMutex mutex; // guards 'results' and 'dirty', which the pool threads use
+    QHash<QByteArray, Measurement> results;
+    bool dirty = false; // 'results' holds measurements the sidecar doesn't
+};
+
+#endif // LOUDNESSANALYZER_H
@@ -1,14 +1,59 @@
 #include "soundboard.h"
+#include "soundboarddaemon.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
-    qputenv("QT_LOGGING_RULES", "qt.multimedia.ffmpeg=false");
+    //ffmpeg's own logging stays quiet; rules already in the environment (the
+    //usbsoundboard.timing category, say) come after it and still apply
+    QByteArray loggingRules = "qt.multimedia.ffmpeg=false";
+    if (qEnvironmentVariableIsSet("QT_LOGGING_RULES"))
+        loggingRules += ";" + qgetenv("QT_LOGGING_RULES");
+    qputenv("QT_LOGGING_RULES", loggingRules);
+
+    StartupProfile::start();
+
+    //the modes without a window run on a QCoreApplication (no platform plugin,
+    //no widgets), so their options are looked at before any application exists
+    QStringList arguments;
+    for (int i = 1; i < argc; ++i) arguments.append(QString::fromLocal8Bit(argv[i]));
+
+    //--benchmark-config [slots]: time loading a large config as JSON and as CBOR, then exit
+    if (arguments.contains("--benchmark-config")) {
+        QCoreApplication a(argc, argv);
+        const int at = arguments.indexOf("--benchmark-config");
+        bool ok = true;
+        const int slots = at + 1 < arguments.size() ? arguments[at + 1].toInt(&ok) : 1000;
+        if (!ok || slots < 1) {
+            qCritical() << "Usage:" << argv[0] << "--benchmark-config [slots, at least 1]";
+            return 1;
+        }
+        ConfigFile::benchmark(slots);
+        return 0;
+    }
+
+    //--headless <config> [--control-name <name>]: play a configuration from the
+    //device with no window or tray icon, taking commands on the given control server
+    if (arguments.contains("--headless")) {
+        QCoreApplication a(argc, argv);
+        const int at = arguments.indexOf("--headless");
+        if (at + 1 >= arguments.size()) {
+            qCritical() << "Usage:" << argv[0] << "--headless <config file> [--control-name <name>]";
+            return 1;
+        }
+        const int nameAt = arguments.indexOf("--control-name");
+        SoundboardDaemon daemon(arguments[at + 1], nameAt >= 0 && nameAt + 1 < arguments.size() ? arguments[nameAt + 1] : QString(CONTROL_SERVER_NAME));
+        if (!daemon.start()) return 1;
+        return a.exec();
+    }
 
     QApplication a(argc, argv);
+
     Soundboard soundboard;
     if(!soundboard.startMinimized)soundboard.show();
+    //the window is up first; devices, the startup config and the sounds follow from the event loop
+    QMetaObject::invokeMethod(&soundboard, &Soundboard::startSubsystems, Qt::QueuedConnection);
     return a.exec();
 }
 
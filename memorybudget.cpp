@@ -0,0 +1,242 @@
+#include "memorybudget.h"
+#include "startupprofile.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QDebug>
+#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+
+#define DEFAULT_BUDGET_MB 256
+#define REBALANCE_DELAY_MS 2000 // Presses are batched; re-planning never runs on the trigger path
+#define USAGE_HALF_LIFE_HOURS 24.0 // A press counts half as much a day later
+#define HEAD_ESTIMATE_MS 300 // What a resident sound keeps in RAM once demoted (the disk cache's head)
+
+MemoryBudget::MemoryBudget(AudioManager *audio, QObject *parent)
+    : QObject(parent), audio(audio), budgetBytes(qint64(DEFAULT_BUDGET_MB) << 20)
+{
+    rebalanceTimer.setSingleShot(true);
+    rebalanceTimer.setInterval(REBALANCE_DELAY_MS);
+    connect(&rebalanceTimer, &QTimer::timeout, this, &MemoryBudget::rebalance);
+
+    loader = new ImportPipeline(this);
+    connect(loader, &ImportPipeline::imported, this, &MemoryBudget::reloaded);
+}
+
+void MemoryBudget::setBudget(qint64 bytes){
+    budgetBytes = std::max<qint64>(0, bytes);
+    rebalanceTimer.start();
+}
+
+qint64 MemoryBudget::budget() const{
+    return budgetBytes;
+}
+
+SampleLoader::Residency MemoryBudget::initialResidency() const{
+    //start resident while there is room
+    return stats().residentBytes < budgetBytes ? SampleLoader::Residency::Resident : SampleLoader::Residency::Streaming;
+}
+
+void MemoryBudget::place(int slot, const QString &path, SamplePtr sample){
+    if (slot < 0 || slot >= MAX_SLOTS)
+        return;
+    audio->setSample(slot, path.isEmpty() ? nullptr : std::move(sample));
+    track(slot, path);
+}
+
+void MemoryBudget::track(int slot, const QString &path){
+    if (slot < 0 || slot >= MAX_SLOTS)
+        return;
+    slotPaths[slot] = path;
+    if (!path.isEmpty())
+        rebalanceTimer.start();
+}
+
+void MemoryBudget::notePress(int slot){
+    if (slot < 0 || slot >= MAX_SLOTS || slotPaths[slot].isEmpty())
+        return;
+
+    Usage &entry = usage[slotPaths[slot]];
+    entry.presses++;
+    entry.lastUsed = QDateTime::currentMSecsSinceEpoch();
+
+    SamplePtr sample = audio->sample(slot);
+    if (sample && sample->streaming())
+        misses++;
+    else if (sample)
+        hits++;
+    rebalanceTimer.start();
+}
+
+// Press count with exponential decay: frequent and recent sounds rank highest,
+// and a sound nobody has pressed in days drifts towards the bottom.
+double MemoryBudget::score(const QString &path, qint64 now) const{
+    const Usage entry = usage.value(path);
+    if (entry.presses == 0)
+        return 0.0;
+    const double ageHours = std::max<qint64>(0, now - entry.lastUsed) / 3600000.0;
+    return entry.presses * std::pow(0.5, ageHours / USAGE_HALF_LIFE_HOURS);
+}
+
+qint64 MemoryBudget::fullBytes(const Sample &sample){
+    return sample.frames * CHANNELS * qint64(sizeof(float));
+}
+
+qint64 MemoryBudget::headBytes(const Sample &sample){
+    return sample.headFrames * CHANNELS * qint64(sizeof(float));
+}
+
+void MemoryBudget::rebalance(){
+    //one entry per distinct file; slots sharing a file share its sample
+    struct Candidate {
+        QString path;
+        double score;
+        qint64 full;
+        qint64 head;
+    };
+    QVector<Candidate> candidates;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int slot = 0; slot < MAX_SLOTS; slot++) {
+        if (slotPaths[slot].isEmpty())
+            continue;
+        const auto known = std::find_if(candidates.begin(), candidates.end(), [&](const Candidate &c){ return c.path == slotPaths[slot]; });
+        SamplePtr sample = audio->sample(slot);
+        if (known != candidates.end() || !sample)
+            continue;
+        //a resident sample has no head yet; assume the cache's head size
+        const qint64 head = sample->streaming() ? headBytes(*sample) : std::min(fullBytes(*sample), qint64(HEAD_ESTIMATE_MS) * sample->sampleRate / 1000 * CHANNELS * qint64(sizeof(float)));
+        candidates.append({slotPaths[slot], score(slotPaths[slot], now), fullBytes(*sample), head});
+    }
+
+    //every sound costs at least its head; the best-ranked ones get the rest of the budget
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b){ return a.score > b.score; });
+    qint64 used = 0;
+    for (const Candidate &c : std::as_const(candidates))
+        used += c.head;
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<ImportPipeline::Job> jobs;
+    for (const Candidate &c : std::as_const(candidates)) {
+        //a sound that can't stream stays in RAM and takes its room from the rest
+        const bool resident = unstreamable.contains(c.path) || used + (c.full - c.head) <= budgetBytes;
+        if (resident)
+            used += c.full - c.head;
+        if (reloading.contains(c.path))
+            continue;
+
+        for (int slot = 0; slot < MAX_SLOTS; slot++) {
+            if (slotPaths[slot] != c.path)
+                continue;
+            SamplePtr current = audio->sample(slot);
+            if (!current || current->streaming() != resident)
+                continue;
+            ImportPipeline::Job job;
+            job.slot = slot;
+            job.path = c.path;
+            job.residency = resident ? SampleLoader::Residency::Resident : SampleLoader::Residency::Streaming;
+            jobs.append(job);
+            reloading.insert(c.path, job.residency);
+            break;
+        }
+    }
+    loader->submit(jobs);
+
+    const Stats s = stats();
+    qCDebug(lcTiming) << "Memory budget:" << (s.residentBytes >> 10) << "of" << (s.budget >> 10) << "KiB resident,"
+             << s.residentSlots << "slots pinned," << s.streamingSlots << "streaming; hits" << s.hits << "misses" << s.misses
+             << "evictions" << s.evictions << "promotions" << s.promotions << "(planned in" << timer.elapsed() << "ms)";
+}
+
+//a sound was loaded again for another residency. every slot still playing that
+//file the other way gets it; the engine retires the old sample and frees it
+//once its voices are done
+void MemoryBudget::reloaded(const ImportPipeline::Result &result){
+    const SampleLoader::Residency asked = reloading.take(result.path);
+    //converted for a rate the streams no longer run at; the owner loads the sounds again
+    if (!result.sample || result.sample->sampleRate != SampleLoader::targetRate())
+        return;
+    const bool resident = !result.sample->streaming();
+    if (asked == SampleLoader::Residency::Streaming && resident) {
+        //asked to stream but loaded whole: without a disk cache it never will
+        unstreamable.insert(result.path);
+        return;
+    }
+    bool placed = false;
+    for (int slot = 0; slot < MAX_SLOTS; slot++) {
+        if (slotPaths[slot] != result.path)
+            continue;
+        SamplePtr current = audio->sample(slot);
+        if (!current || current->streaming() != resident)
+            continue;
+        audio->setSample(slot, result.sample);
+        placed = true;
+    }
+    if (!placed)
+        return;
+    if (resident)
+        promotions++;
+    else
+        evictions++;
+}
+
+MemoryBudget::Stats MemoryBudget::stats() const{
+    Stats s;
+    s.budget = budgetBytes;
+    s.hits = hits;
+    s.misses = misses;
+    s.evictions = evictions;
+    s.promotions = promotions;
+
+    //count each distinct sample once
+    QVector<const Sample *> seen;
+    for (int slot = 0; slot < MAX_SLOTS; slot++) {
+        if (slotPaths[slot].isEmpty())
+            continue;
+        SamplePtr sample = audio->sample(slot);
+        if (!sample)
+            continue;
+        if (sample->streaming())
+            s.streamingSlots++;
+        else
+            s.residentSlots++;
+        if (seen.contains(sample.get()))
+            continue;
+        seen.append(sample.get());
+        s.residentBytes += sample->streaming() ? headBytes(*sample) : fullBytes(*sample);
+    }
+    return s;
+}
+
+void MemoryBudget::loadUsage(const QString &fileName){
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    const QJsonObject object = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        const QJsonObject entry = it.value().toObject();
+        usage[it.key()] = {quint64(entry["presses"].toInteger()), entry["lastUsed"].toInteger()};
+    }
+}
+
+void MemoryBudget::saveUsage(const QString &fileName) const{
+    QJsonObject object;
+    for (auto it = usage.begin(); it != usage.end(); ++it) {
+        QJsonObject entry;
+        entry["presses"] = qint64(it.value().presses);
+        entry["lastUsed"] = it.value().lastUsed;
+        object[it.key()] = entry;
+    }
+    //written next to the old file and renamed over it, like the configs
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+    file.write(QJsonDocument(object).toJson());
+    if (!file.commit())
+        qDebug() << "Could not save" << fileName << ":" << file.errorString();
+}
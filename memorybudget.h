@@ -0,0 +1,91 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include "audiomanager.h"
+#include "sampleloader.h"
+#include "importpipeline.h"
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+
+// Decides which slots keep their sound fully in RAM and which stream from the
+// disk cache with only the head resident, so decoded audio stays within a
+// budget. Every press is recorded per sound file (count and time, persisted in
+// usage.json next to init.json); the most used sounds are pinned in RAM and
+// the rest are evicted to streaming, most-recently-and-often used first.
+// Moving a sound in or out of RAM decodes or maps it again, which happens on
+// the budget's own import pool; the new sample is swapped in when it arrives.
+class MemoryBudget : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats {
+        qint64 budget = 0;
+        qint64 residentBytes = 0;  // decoded audio held in RAM (full sounds and heads)
+        int residentSlots = 0;     // slots fully in RAM
+        int streamingSlots = 0;    // slots streaming from the cache
+        quint64 hits = 0;          // presses of a fully resident slot
+        quint64 misses = 0;        // presses of a streaming slot
+        quint64 evictions = 0;     // slots demoted to streaming
+        quint64 promotions = 0;    // slots pinned back into RAM
+    };
+
+    explicit MemoryBudget(AudioManager *audio, QObject *parent = nullptr);
+
+    void setBudget(qint64 bytes);
+    qint64 budget() const;
+
+    //how a sound loaded now should start out; rebalance() sorts it out once all slots are in
+    SampleLoader::Residency initialResidency() const;
+
+    //put 'sample', loaded from 'path', into 'slot' (an empty path clears it)
+    void place(int slot, const QString &path, SamplePtr sample);
+
+    //note that 'slot' now plays 'path' when the engine was handed its sample
+    //directly (a bank switch swaps every slot at once)
+    void track(int slot, const QString &path);
+
+    //record a press of 'slot' and re-plan residency shortly after
+    void notePress(int slot);
+
+    Stats stats() const;
+
+    void loadUsage(const QString &fileName);
+    void saveUsage(const QString &fileName) const;
+
+public slots:
+    //re-rank the loaded sounds and move slots in or out of RAM to fit the budget
+    void rebalance();
+
+private slots:
+    void reloaded(const ImportPipeline::Result &result);
+
+private:
+    struct Usage {
+        quint64 presses = 0;
+        qint64 lastUsed = 0; // ms since epoch
+    };
+
+    double score(const QString &path, qint64 now) const;
+    static qint64 fullBytes(const Sample &sample);
+    static qint64 headBytes(const Sample &sample);
+
+    AudioManager *audio;
+    qint64 budgetBytes;
+    QString slotPaths[MAX_SLOTS];
+    QHash<QString, Usage> usage;
+    QTimer rebalanceTimer;
+    ImportPipeline *loader;
+    QHash<QString,SampleLoader::Residency> reloading; // files being loaded again, and how
+    QSet<QString> unstreamable; // files that load resident even when asked to stream (no disk cache)
+
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 evictions = 0;
+    quint64 promotions = 0;
+};
+
+#endif // MEMORYBUDGET_H
@@ -0,0 +1,114 @@
+#include "midisource.h"
+
+#include <QVector>
+#include <QDebug>
+
+#include <alsa/asoundlib.h>
+#include <poll.h>
+#include <cerrno>
+
+#define MIDI_CLIENT_NAME "UsbSoundboard" // How the source shows up in aconnect and patchbays
+#define MIDI_PORT_NAME "Triggers" // Its one input port
+
+//how hard a note was hit (1..127) as the gain of its voice. the square
+//follows how loud a hit sounds better than a straight line does
+static float velocityGain(int velocity) {
+    return float(velocity * velocity) / (127.0f * 127.0f);
+}
+
+MidiSource::MidiSource(TriggerQueue *queue, QObject *parent)
+    : TriggerSource("midi", queue, parent)
+{
+}
+
+MidiSource::~MidiSource(){
+    stop();
+}
+
+void MidiSource::setBaseNote(int note){
+    baseNote = note;
+}
+
+void MidiSource::run(){
+    snd_seq_t *seq = nullptr;
+    if (snd_seq_open(&seq, "default", SND_SEQ_OPEN_INPUT, SND_SEQ_NONBLOCK) < 0) {
+        qDebug() << "No ALSA sequencer; MIDI controllers won't trigger sounds";
+        return;
+    }
+    snd_seq_set_client_name(seq, MIDI_CLIENT_NAME);
+    const int port = snd_seq_create_simple_port(seq, MIDI_PORT_NAME,
+                                                SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
+                                                SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+    if (port < 0) {
+        qDebug() << "Failed to create the MIDI trigger port:" << snd_strerror(port);
+        snd_seq_close(seq);
+        return;
+    }
+
+    //the controllers there are now, and the ones plugged in later (announced by the system client)
+    snd_seq_connect_from(seq, port, SND_SEQ_CLIENT_SYSTEM, SND_SEQ_PORT_SYSTEM_ANNOUNCE);
+    snd_seq_client_info_t *clientInfo;
+    snd_seq_port_info_t *portInfo;
+    snd_seq_client_info_alloca(&clientInfo);
+    snd_seq_port_info_alloca(&portInfo);
+    snd_seq_client_info_set_client(clientInfo, -1);
+    while (snd_seq_query_next_client(seq, clientInfo) >= 0) {
+        const int client = snd_seq_client_info_get_client(clientInfo);
+        snd_seq_port_info_set_client(portInfo, client);
+        snd_seq_port_info_set_port(portInfo, -1);
+        while (snd_seq_query_next_port(seq, portInfo) >= 0)
+            connectController(seq, port, client, snd_seq_port_info_get_port(portInfo));
+    }
+
+    //fds[0] ends the thread, the rest are the sequencer's
+    const int count = snd_seq_poll_descriptors_count(seq, POLLIN);
+    QVector<pollfd> fds(count + 1);
+    fds[0] = {stopFd(), POLLIN, 0};
+    snd_seq_poll_descriptors(seq, fds.data() + 1, count, POLLIN);
+    qDebug() << "MIDI triggers on" << MIDI_CLIENT_NAME ":" MIDI_PORT_NAME << "client" << snd_seq_client_id(seq);
+
+    while (!isInterruptionRequested()) {
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[0].revents)
+            break;
+
+        snd_seq_event_t *event = nullptr;
+        int result;
+        while ((result = snd_seq_event_input(seq, &event)) >= 0 || result == -ENOSPC) {
+            //-ENOSPC: events were lost because the thread fell behind; the rest still come
+            if (result == -ENOSPC) {
+                qDebug() << "MIDI input overran; some notes were dropped";
+                continue;
+            }
+            switch (event->type) {
+            case SND_SEQ_EVENT_NOTEON:
+                //a note on with no velocity is how running status sends a note off
+                if (event->data.note.velocity > 0)
+                    trigger(event->data.note.note - baseNote, velocityGain(event->data.note.velocity));
+                break;
+            case SND_SEQ_EVENT_PORT_START:
+                connectController(seq, port, event->data.addr.client, event->data.addr.port);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    snd_seq_close(seq);
+}
+
+//connects a port to the trigger port if it is a hardware controller that sends notes
+void MidiSource::connectController(snd_seq_t *seq, int port, int client, int controllerPort){
+    snd_seq_port_info_t *info;
+    snd_seq_port_info_alloca(&info);
+    if (snd_seq_get_any_port_info(seq, client, controllerPort, info) < 0) return;
+
+    const unsigned int sends = SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ;
+    if ((snd_seq_port_info_get_capability(info) & sends) != sends) return;
+    if (!(snd_seq_port_info_get_type(info) & SND_SEQ_PORT_TYPE_HARDWARE)) return;
+    if (snd_seq_connect_from(seq, port, client, controllerPort) >= 0)
+        qDebug() << "MIDI triggers from" << snd_seq_port_info_get_name(info);
+}
@@ -0,0 +1,34 @@
+#ifndef MIDISOURCE_H
+#define MIDISOURCE_H
+
+#include "triggersource.h"
+
+#include <atomic>
+
+typedef struct _snd_seq snd_seq_t;
+
+// MIDI controllers through the ALSA sequencer. The source shows up as the
+// client "UsbSoundboard" with a "Triggers" port; hardware controllers are
+// connected to it as they appear, anything else (virtual ports, other
+// programs) with aconnect or a patchbay. A note on triggers slot
+// note - baseNote, and how hard it was hit sets the voice's gain.
+class MidiSource : public TriggerSource
+{
+    Q_OBJECT
+public:
+    explicit MidiSource(TriggerQueue *queue, QObject *parent = nullptr);
+    ~MidiSource();
+
+    // The note that triggers slot 1. Any thread.
+    void setBaseNote(int note);
+
+protected:
+    void run() override;
+
+private:
+    void connectController(snd_seq_t *seq, int port, int client, int controllerPort);
+
+    std::atomic<int> baseNote{0};
+};
+
+#endif // MIDISOURCE_H
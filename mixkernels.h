@@ -0,0 +1,107 @@
+#ifndef MIXKERNELS_H
+#define MIXKERNELS_H
+
+#include <QtGlobal>
+
+// Inner loops of the mixer. Everything here runs on the audio thread, so it
+// must not allocate, lock or branch on the sample data.
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MIXKERNELS_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIXKERNELS_NEON
+#endif
+
+// A gain that moves linearly to its target over a number of frames. Owned by
+// the audio thread; the per-block bookkeeping branches, the kernels don't.
+struct GainRamp
+{
+    float value = 0.0f;
+    float target = 0.0f;
+    float step = 0.0f;
+    qint64 remaining = 0;
+
+    void reset(float gain) {
+        value = target = gain;
+        step = 0.0f;
+        remaining = 0;
+    }
+
+    //start a new ramp from the current value
+    void rampTo(float gain, qint64 frames) {
+        target = gain;
+        if (frames <= 0) {
+            reset(gain);
+            return;
+        }
+        step = (gain - value) / frames;
+        remaining = frames;
+    }
+
+    //move the ramp on by 'frames' (at most 'remaining')
+    void advance(qint64 frames) {
+        remaining -= frames;
+        value += step * frames;
+        if (remaining <= 0)
+            reset(target);
+    }
+};
+
+//dst[i] += src[i] * gain, for 'count' floats
+inline void mixAccumulate(float *dst, const float *src, float gain, qsizetype count)
+{
+    qsizetype i = 0;
+#if defined(MIXKERNELS_SSE)
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 8 <= count; i += 8) {
+        const __m128 a = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g));
+        const __m128 b = _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(_mm_loadu_ps(src + i + 4), g));
+        _mm_storeu_ps(dst + i, a);
+        _mm_storeu_ps(dst + i + 4, b);
+    }
+#elif defined(MIXKERNELS_NEON)
+    for (; i + 8 <= count; i += 8) {
+        vst1q_f32(dst + i, vmlaq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), gain));
+        vst1q_f32(dst + i + 4, vmlaq_n_f32(vld1q_f32(dst + i + 4), vld1q_f32(src + i + 4), gain));
+    }
+#endif
+    for (; i < count; i++)
+        dst[i] += src[i] * gain;
+}
+
+//dst += src * (gain + step * frame), for 'frames' interleaved stereo frames
+inline void mixAccumulateRamp(float *dst, const float *src, float gain, float step, qsizetype frames)
+{
+    qsizetype f = 0;
+#if defined(MIXKERNELS_SSE)
+    // Two stereo frames per vector: gains are {g0, g0, g1, g1}.
+    const __m128 base = _mm_set1_ps(gain);
+    const __m128 steps = _mm_set1_ps(step);
+    __m128 index = _mm_set_ps(1.0f, 1.0f, 0.0f, 0.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    for (; f + 2 <= frames; f += 2) {
+        const __m128 g = _mm_add_ps(base, _mm_mul_ps(steps, index));
+        _mm_storeu_ps(dst + f * 2, _mm_add_ps(_mm_loadu_ps(dst + f * 2), _mm_mul_ps(_mm_loadu_ps(src + f * 2), g)));
+        index = _mm_add_ps(index, two);
+    }
+#elif defined(MIXKERNELS_NEON)
+    const float32x4_t base = vdupq_n_f32(gain);
+    const float indices[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+    float32x4_t index = vld1q_f32(indices);
+    const float32x4_t two = vdupq_n_f32(2.0f);
+    for (; f + 2 <= frames; f += 2) {
+        const float32x4_t g = vmlaq_n_f32(base, index, step);
+        vst1q_f32(dst + f * 2, vmlaq_f32(vld1q_f32(dst + f * 2), vld1q_f32(src + f * 2), g));
+        index = vaddq_f32(index, two);
+    }
+#endif
+    for (; f < frames; f++) {
+        const float g = gain + step * f;
+        dst[f * 2] += src[f * 2] * g;
+        dst[f * 2 + 1] += src[f * 2 + 1] * g;
+    }
+}
+
+#endif // MIXKERNELS_H
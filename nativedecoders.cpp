@@ -0,0 +1,621 @@
+#include "nativedecoders.h"
+
+#ifdef HAVE_MPG123
+#include <mpg123.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+quint16 readLE16(const uchar *p) { return quint16(p[0] | (p[1] << 8)); }
+quint32 readLE32(const uchar *p) { return quint32(p[0] | (p[1] << 8) | (p[2] << 16) | (quint32(p[3]) << 24)); }
+
+// Size of an ID3v2 tag at the start of the file (0 if there is none).
+// Both FLAC and MP3 files are commonly found with one in front.
+qsizetype id3v2Size(const QByteArray &data)
+{
+    if (data.size() < 10 || !data.startsWith("ID3"))
+        return 0;
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    const qsizetype size = (qsizetype(p[6] & 0x7f) << 21) | ((p[7] & 0x7f) << 14) | ((p[8] & 0x7f) << 7) | (p[9] & 0x7f);
+    const bool footer = p[5] & 0x10;
+    return std::min<qsizetype>(data.size(), 10 + size + (footer ? 10 : 0));
+}
+
+// Appends 'frames' frames of 'channels' planar or interleaved samples as stereo.
+// 'at(frame, channel)' returns a sample already scaled to [-1, 1].
+template <typename Accessor>
+void appendStereo(QVector<float> &out, qsizetype frames, int channels, Accessor at)
+{
+    const qsizetype start = out.size();
+    out.resize(start + frames * 2);
+    float *dst = out.data() + start;
+    if (channels == 1) {
+        for (qsizetype f = 0; f < frames; f++)
+            dst[f * 2] = dst[f * 2 + 1] = at(f, 0);
+    }
+    else {
+        // Anything beyond two channels is dropped; the board has no use for surround.
+        for (qsizetype f = 0; f < frames; f++) {
+            dst[f * 2] = at(f, 0);
+            dst[f * 2 + 1] = at(f, 1);
+        }
+    }
+}
+
+// MSB-first bit reader over a byte buffer, as FLAC needs it.
+class BitReader
+{
+public:
+    BitReader(const uchar *data, qsizetype size) : data(data), size(size) {}
+
+    bool atEnd() const { return position >= size && bitCount == 0; }
+    bool overrun() const { return overran; }
+    qsizetype bytePosition() const { return position - bitCount / 8; }
+
+    quint32 read(int bits) {
+        if (bits == 0)
+            return 0;
+        refill();
+        if (bitCount < bits) {
+            overran = true;
+            return 0;
+        }
+        const quint32 value = quint32(cache >> (64 - bits));
+        cache <<= bits;
+        bitCount -= bits;
+        return value;
+    }
+
+    qint32 readSigned(int bits) {
+        if (bits == 0)
+            return 0;
+        const quint32 value = read(bits);
+        return qint32(value << (32 - bits)) >> (32 - bits);
+    }
+
+    // Number of 0 bits before the next 1 bit, which is consumed.
+    quint32 readUnary() {
+        quint32 zeros = 0;
+        for (;;) {
+            refill();
+            if (bitCount == 0) {
+                overran = true;
+                return zeros;
+            }
+            if (cache != 0) {
+                const int leading = countLeadingZeros(cache);
+                if (leading < bitCount) {
+                    //shifting a 64-bit value by 64 is undefined, so drop the bits in two steps
+                    cache = (cache << leading) << 1;
+                    bitCount -= leading + 1;
+                    return zeros + leading;
+                }
+            }
+            zeros += bitCount;
+            cache = 0;
+            bitCount = 0;
+        }
+    }
+
+    void alignToByte() {
+        const int drop = bitCount % 8;
+        cache <<= drop;
+        bitCount -= drop;
+    }
+
+    void seek(qsizetype byte) {
+        position = std::min(byte, size);
+        cache = 0;
+        bitCount = 0;
+    }
+
+private:
+    void refill() {
+        while (bitCount <= 56 && position < size) {
+            cache |= quint64(data[position++]) << (56 - bitCount);
+            bitCount += 8;
+        }
+    }
+
+    static int countLeadingZeros(quint64 value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_clzll(value);
+#else
+        int n = 0;
+        while (!(value & (quint64(1) << 63))) {
+            value <<= 1;
+            n++;
+        }
+        return n;
+#endif
+    }
+
+    const uchar *data;
+    qsizetype size;
+    qsizetype position = 0;
+    quint64 cache = 0;  // left-aligned
+    int bitCount = 0;
+    bool overran = false;
+};
+
+// FLAC residual: a partitioned Rice code (RFC 9639, section 9.2.7).
+bool readResidual(BitReader &bits, int blockSize, int order, qint32 *out)
+{
+    const int method = bits.read(2);
+    if (method > 1)
+        return false;
+    const int paramBits = method == 0 ? 4 : 5;
+    const quint32 escape = method == 0 ? 15 : 31;
+    const int partitionOrder = bits.read(4);
+    const int partitions = 1 << partitionOrder;
+    const int partitionSize = blockSize >> partitionOrder;
+    if ((partitionSize << partitionOrder) != blockSize || partitionSize < order)
+        return false;
+
+    int n = 0;
+    for (int p = 0; p < partitions; p++) {
+        const int count = p == 0 ? partitionSize - order : partitionSize;
+        const quint32 param = bits.read(paramBits);
+        if (param == escape) {
+            const int raw = bits.read(5);
+            for (int i = 0; i < count; i++)
+                out[n++] = bits.readSigned(raw);
+        }
+        else {
+            for (int i = 0; i < count; i++) {
+                const quint32 value = (bits.readUnary() << param) | bits.read(param);
+                out[n++] = qint32(value >> 1) ^ -qint32(value & 1);
+            }
+        }
+        if (bits.overrun())
+            return false;
+    }
+    return true;
+}
+
+// One FLAC subframe into 'out' (blockSize samples at 'bps' bits).
+bool readSubframe(BitReader &bits, int blockSize, int bps, qint32 *out)
+{
+    if (bits.read(1) != 0 || bps > 32)
+        return false;
+    const int type = bits.read(6);
+    int wasted = 0;
+    if (bits.read(1)) {
+        wasted = bits.readUnary() + 1;
+        bps -= wasted;
+        if (bps <= 0)
+            return false;
+    }
+
+    if (type == 0) {
+        // CONSTANT
+        std::fill_n(out, blockSize, bits.readSigned(bps));
+    }
+    else if (type == 1) {
+        // VERBATIM
+        for (int i = 0; i < blockSize; i++)
+            out[i] = bits.readSigned(bps);
+    }
+    else if (type >= 8 && type <= 12) {
+        // FIXED predictor of order 0-4
+        const int order = type & 7;
+        if (order > blockSize)
+            return false;
+        for (int i = 0; i < order; i++)
+            out[i] = bits.readSigned(bps);
+        if (!readResidual(bits, blockSize, order, out + order))
+            return false;
+        switch (order) {
+        case 1:
+            for (int i = 1; i < blockSize; i++)
+                out[i] += out[i - 1];
+            break;
+        case 2:
+            for (int i = 2; i < blockSize; i++)
+                out[i] += 2 * out[i - 1] - out[i - 2];
+            break;
+        case 3:
+            for (int i = 3; i < blockSize; i++)
+                out[i] += 3 * out[i - 1] - 3 * out[i - 2] + out[i - 3];
+            break;
+        case 4:
+            for (int i = 4; i < blockSize; i++)
+                out[i] += 4 * out[i - 1] - 6 * out[i - 2] + 4 * out[i - 3] - out[i - 4];
+            break;
+        }
+    }
+    else if (type >= 32) {
+        // LPC of order 1-32
+        const int order = (type & 31) + 1;
+        if (order > blockSize)
+            return false;
+        for (int i = 0; i < order; i++)
+            out[i] = bits.readSigned(bps);
+        const int precision = bits.read(4) + 1;
+        if (precision == 16)
+            return false;
+        const int shift = bits.readSigned(5);
+        if (shift < 0)
+            return false;
+        qint32 coefs[32];
+        for (int i = 0; i < order; i++)
+            coefs[i] = bits.readSigned(precision);
+        if (!readResidual(bits, blockSize, order, out + order))
+            return false;
+        for (int i = order; i < blockSize; i++) {
+            qint64 sum = 0;
+            for (int j = 0; j < order; j++)
+                sum += qint64(coefs[j]) * out[i - 1 - j];
+            out[i] += qint32(sum >> shift);
+        }
+    }
+    else {
+        return false;
+    }
+
+    if (wasted) {
+        for (int i = 0; i < blockSize; i++)
+            out[i] = qint32(quint32(out[i]) << wasted);
+    }
+    return !bits.overrun();
+}
+
+// The UTF-8-like frame/sample number in a FLAC frame header. Only validated, not used.
+bool skipCodedNumber(BitReader &bits)
+{
+    const quint32 first = bits.read(8);
+    int extra = 0;
+    if (first < 0x80) extra = 0;
+    else if ((first & 0xe0) == 0xc0) extra = 1;
+    else if ((first & 0xf0) == 0xe0) extra = 2;
+    else if ((first & 0xf8) == 0xf0) extra = 3;
+    else if ((first & 0xfc) == 0xf8) extra = 4;
+    else if ((first & 0xfe) == 0xfc) extra = 5;
+    else if (first == 0xfe) extra = 6;
+    else return false;
+    for (int i = 0; i < extra; i++) {
+        if ((bits.read(8) & 0xc0) != 0x80)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+NativeDecoders::Format NativeDecoders::detect(const QByteArray &data){
+    if (data.size() >= 12 && data.startsWith("RIFF") && data.mid(8, 4) == "WAVE")
+        return Wav;
+
+    // FLAC and MP3 may both come behind an ID3v2 tag.
+    const qsizetype offset = id3v2Size(data);
+    if (data.size() >= offset + 4 && data.mid(offset, 4) == "fLaC")
+        return Flac;
+    if (offset > 0)
+        return Mp3;
+    if (data.size() >= 2) {
+        const uchar b0 = uchar(data[0]), b1 = uchar(data[1]);
+        // MPEG audio frame sync, layer III
+        if (b0 == 0xff && (b1 & 0xe0) == 0xe0 && (b1 & 0x06) == 0x02)
+            return Mp3;
+    }
+    return Unknown;
+}
+
+bool NativeDecoders::supports(Format format){
+    switch (format) {
+    case Wav:
+    case Flac:
+        return true;
+    case Mp3:
+#ifdef HAVE_MPG123
+        return true;
+#else
+        return false;
+#endif
+    default:
+        return false;
+    }
+}
+
+bool NativeDecoders::decode(Format format, const QByteArray &data, Sample &sample, QString *error){
+    bool ok = false;
+    switch (format) {
+    case Wav:  ok = decodeWav(data, sample, error); break;
+    case Flac: ok = decodeFlac(data, sample, error); break;
+    case Mp3:  ok = decodeMp3(data, sample, error); break;
+    default:
+        if (error) *error = "Unknown audio format.";
+        return false;
+    }
+    if (ok)
+        sample.frames = sample.data.size() / 2;
+    return ok;
+}
+
+//RIFF/WAVE with integer PCM (8-32 bit) or IEEE float (32/64 bit) data
+bool NativeDecoders::decodeWav(const QByteArray &data, Sample &sample, QString *error){
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    const qsizetype size = data.size();
+
+    int formatTag = 0, channels = 0, sampleRate = 0, bitsPerSample = 0, blockAlign = 0;
+    const uchar *pcm = nullptr;
+    qsizetype pcmSize = 0;
+
+    //walk the chunks; "fmt " must come before "data"
+    qsizetype pos = 12;
+    while (pos + 8 <= size && !pcm) {
+        const QByteArray id = data.mid(pos, 4);
+        const qsizetype chunkSize = readLE32(bytes + pos + 4);
+        const qsizetype body = pos + 8;
+
+        if (id == "fmt ") {
+            if (chunkSize < 16 || body + 16 > size)
+                break;
+            formatTag = readLE16(bytes + body);
+            channels = readLE16(bytes + body + 2);
+            sampleRate = int(readLE32(bytes + body + 4));
+            blockAlign = readLE16(bytes + body + 12);
+            bitsPerSample = readLE16(bytes + body + 14);
+            //WAVE_FORMAT_EXTENSIBLE keeps the real format in the sub-format GUID
+            if (formatTag == 0xfffe && chunkSize >= 40 && body + 26 <= size)
+                formatTag = readLE16(bytes + body + 24);
+        }
+        else if (id == "data") {
+            pcm = bytes + body;
+            //some writers leave the size at 0 or -1 when streaming; take the rest of the file
+            pcmSize = (chunkSize == 0 || body + chunkSize > size) ? size - body : chunkSize;
+        }
+        pos = body + chunkSize + (chunkSize & 1);
+    }
+
+    const bool isInt = formatTag == 1 && (bitsPerSample == 8 || bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32);
+    const bool isFloat = formatTag == 3 && (bitsPerSample == 32 || bitsPerSample == 64);
+    if (!pcm || channels <= 0 || sampleRate <= 0 || (!isInt && !isFloat) || blockAlign < channels * bitsPerSample / 8) {
+        if (error) *error = "Unsupported or malformed WAV file.";
+        return false;
+    }
+
+    const qsizetype frames = pcmSize / blockAlign;
+    const int bytesPerSample = bitsPerSample / 8;
+    sample.sampleRate = sampleRate;
+    sample.data.reserve(frames * 2);
+
+    auto sampleAt = [&](qsizetype frame, int channel) -> const uchar * {
+        return pcm + frame * blockAlign + channel * bytesPerSample;
+    };
+
+    if (isFloat && bitsPerSample == 32) {
+        appendStereo(sample.data, frames, channels, [&](qsizetype f, int c) {
+            float value;
+            std::memcpy(&value, sampleAt(f, c), sizeof(value));
+            return value;
+        });
+    }
+    else if (isFloat) {
+        appendStereo(sample.data, frames, channels, [&](qsizetype f, int c) {
+            double value;
+            std::memcpy(&value, sampleAt(f, c), sizeof(value));
+            return float(value);
+        });
+    }
+    else if (bitsPerSample == 8) {
+        appendStereo(sample.data, frames, channels, [&](qsizetype f, int c) {
+            return (int(*sampleAt(f, c)) - 128) * (1.0f / 128.0f);
+        });
+    }
+    else if (bitsPerSample == 16) {
+        appendStereo(sample.data, frames, channels, [&](qsizetype f, int c) {
+            return qint16(readLE16(sampleAt(f, c))) * (1.0f / 32768.0f);
+        });
+    }
+    else if (bitsPerSample == 24) {
+        appendStereo(sample.data, frames, channels, [&](qsizetype f, int c) {
+            const uchar *p = sampleAt(f, c);
+            const qint32 value = qint32((quint32(p[0]) << 8) | (quint32(p[1]) << 16) | (quint32(p[2]) << 24)) >> 8;
+            return value * (1.0f / 8388608.0f);
+        });
+    }
+    else {
+        appendStereo(sample.data, frames, channels, [&](qsizetype f, int c) {
+            return qint32(readLE32(sampleAt(f, c))) * (1.0f / 2147483648.0f);
+        });
+    }
+    return true;
+}
+
+//native FLAC (RFC 9639): STREAMINFO plus every frame, fixed and LPC subframes
+bool NativeDecoders::decodeFlac(const QByteArray &data, Sample &sample, QString *error){
+    auto fail = [error](const char *message) {
+        if (error) *error = QString("FLAC: %1").arg(message);
+        return false;
+    };
+
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    const qsizetype size = data.size();
+    qsizetype pos = id3v2Size(data) + 4;
+
+    //metadata blocks; only STREAMINFO (always first) matters here
+    int streamRate = 0, streamChannels = 0, streamBps = 0, maxBlockSize = 0;
+    qint64 totalFrames = 0;
+    for (bool last = false; !last; ) {
+        if (pos + 4 > size)
+            return fail("truncated metadata");
+        last = bytes[pos] & 0x80;
+        const int type = bytes[pos] & 0x7f;
+        const qsizetype length = (qsizetype(bytes[pos + 1]) << 16) | (bytes[pos + 2] << 8) | bytes[pos + 3];
+        pos += 4;
+        if (type == 0) {
+            if (length < 34 || pos + 34 > size)
+                return fail("bad STREAMINFO");
+            const uchar *info = bytes + pos;
+            maxBlockSize = (info[2] << 8) | info[3];
+            streamRate = (info[10] << 12) | (info[11] << 4) | (info[12] >> 4);
+            streamChannels = ((info[12] >> 1) & 7) + 1;
+            streamBps = (((info[12] & 1) << 4) | (info[13] >> 4)) + 1;
+            totalFrames = (qint64(info[13] & 0x0f) << 32) | (qint64(info[14]) << 24) | (info[15] << 16) | (info[16] << 8) | info[17];
+        }
+        pos += length;
+    }
+    if (streamRate == 0)
+        return fail("missing STREAMINFO");
+
+    sample.sampleRate = streamRate;
+    //STREAMINFO's total is only a hint from the file; reserve no more than the file
+    //could hold stored verbatim, so a corrupt header can't ask for gigabytes
+    const qint64 framesInFile = qint64(size) * 8 / (streamChannels * streamBps) + maxBlockSize;
+    if (totalFrames > 0)
+        sample.data.reserve(std::min(totalFrames, framesInFile) * 2);
+
+    static const int blockSizes[16] = {0, 192, 576, 1152, 2304, 4608, -1, -2, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768};
+    static const int sampleSizes[8] = {0, 8, 12, -1, 16, 20, 24, 32};
+
+    QVector<qint32> channelData(qsizetype(streamChannels) * std::max(maxBlockSize, 16));
+    BitReader bits(bytes, size);
+    bits.seek(pos);
+
+    while (bits.bytePosition() + 2 <= size) {
+        //frame header; trailing tags after the last frame end the stream
+        if (bits.read(15) != 0x7ffc) {
+            if (!sample.data.isEmpty())
+                break;
+            return fail("lost frame sync");
+        }
+        bits.read(1); //blocking strategy
+        const int blockCode = bits.read(4);
+        const int rateCode = bits.read(4);
+        const int assignment = bits.read(4);
+        const int sizeCode = bits.read(3);
+        bits.read(1);
+        if (!skipCodedNumber(bits))
+            return fail("bad frame number");
+
+        int blockSize = blockSizes[blockCode];
+        if (blockSize == -1) blockSize = bits.read(8) + 1;
+        else if (blockSize == -2) blockSize = bits.read(16) + 1;
+        if (blockSize <= 0)
+            return fail("bad block size");
+
+        if (rateCode == 12) bits.read(8);
+        else if (rateCode == 13 || rateCode == 14) bits.read(16);
+        else if (rateCode == 15) return fail("bad sample rate");
+
+        const int bps = sizeCode == 0 ? streamBps : sampleSizes[sizeCode];
+        if (bps <= 0)
+            return fail("bad sample size");
+        const int channels = assignment < 8 ? assignment + 1 : 2;
+        if (assignment > 10)
+            return fail("bad channel assignment");
+        bits.read(8); //header CRC-8
+
+        if (channelData.size() < qsizetype(channels) * blockSize)
+            channelData.resize(qsizetype(channels) * blockSize);
+
+        for (int c = 0; c < channels; c++) {
+            //the side channel carries one extra bit
+            const bool side = (assignment == 8 && c == 1) || (assignment == 9 && c == 0) || (assignment == 10 && c == 1);
+            if (!readSubframe(bits, blockSize, bps + (side ? 1 : 0), channelData.data() + c * blockSize))
+                return fail("corrupt subframe");
+        }
+        bits.alignToByte();
+        bits.read(16); //frame CRC-16
+        if (bits.overrun())
+            return fail("truncated frame");
+
+        qint32 *left = channelData.data();
+        qint32 *right = channelData.data() + blockSize;
+        switch (assignment) {
+        case 8: //left/side
+            for (int i = 0; i < blockSize; i++)
+                right[i] = left[i] - right[i];
+            break;
+        case 9: //side/right
+            for (int i = 0; i < blockSize; i++)
+                left[i] += right[i];
+            break;
+        case 10: //mid/side
+            for (int i = 0; i < blockSize; i++) {
+                const qint64 side = right[i];
+                const qint64 mid = (qint64(left[i]) * 2) | (side & 1);
+                left[i] = qint32((mid + side) >> 1);
+                right[i] = qint32((mid - side) >> 1);
+            }
+            break;
+        }
+
+        const float scale = 1.0f / float(qint64(1) << (bps - 1));
+        const qint32 *planes = channelData.constData();
+        appendStereo(sample.data, blockSize, channels, [&](qsizetype f, int c) {
+            return planes[c * blockSize + f] * scale;
+        });
+
+        if (totalFrames > 0 && sample.data.size() / 2 >= totalFrames)
+            break;
+    }
+
+    if (sample.data.isEmpty())
+        return fail("no audio frames");
+    return true;
+}
+
+//MP3 through libmpg123 when the build found it; QAudioDecoder handles it otherwise
+bool NativeDecoders::decodeMp3(const QByteArray &data, Sample &sample, QString *error){
+#ifdef HAVE_MPG123
+    static const bool initialized = mpg123_init() == MPG123_OK;
+    int err = MPG123_OK;
+    mpg123_handle *handle = initialized ? mpg123_new(nullptr, &err) : nullptr;
+    if (!handle) {
+        if (error) *error = QString("MP3: %1").arg(mpg123_plain_strerror(err));
+        return false;
+    }
+
+    //float output at the file's own rate and channel count
+    mpg123_param(handle, MPG123_ADD_FLAGS, MPG123_QUIET, 0);
+    mpg123_format_none(handle);
+    const long *rates = nullptr;
+    size_t rateCount = 0;
+    mpg123_rates(&rates, &rateCount);
+    for (size_t i = 0; i < rateCount; i++)
+        mpg123_format(handle, rates[i], MPG123_MONO | MPG123_STEREO, MPG123_ENC_FLOAT_32);
+
+    bool ok = mpg123_open_feed(handle) == MPG123_OK
+              && mpg123_feed(handle, reinterpret_cast<const unsigned char *>(data.constData()), data.size()) == MPG123_OK;
+
+    int channels = 2;
+    float buffer[4608];
+    while (ok) {
+        size_t done = 0;
+        const int result = mpg123_read(handle, reinterpret_cast<unsigned char *>(buffer), sizeof(buffer), &done);
+        if (result == MPG123_NEW_FORMAT) {
+            long rate = 0;
+            int encoding = 0;
+            mpg123_getformat(handle, &rate, &channels, &encoding);
+            sample.sampleRate = int(rate);
+        }
+        const qsizetype frames = qsizetype(done / sizeof(float)) / channels;
+        appendStereo(sample.data, frames, channels, [&](qsizetype f, int c) {
+            return buffer[f * channels + c];
+        });
+        if (result == MPG123_NEED_MORE || result == MPG123_DONE)
+            break;
+        if (result != MPG123_OK && result != MPG123_NEW_FORMAT) {
+            if (error) *error = QString("MP3: %1").arg(mpg123_strerror(handle));
+            ok = false;
+        }
+    }
+
+    mpg123_delete(handle);
+    if (ok && (sample.data.isEmpty() || sample.sampleRate <= 0)) {
+        if (error) *error = "MP3: no audio frames";
+        ok = false;
+    }
+    return ok;
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(sample);
+    if (error) *error = "MP3 decoding is not built in.";
+    return false;
+#endif
+}
@@ -0,0 +1,38 @@
+#ifndef NATIVEDECODERS_H
+#define NATIVEDECODERS_H
+
+#include "audiosample.h"
+
+#include <QByteArray>
+#include <QString>
+
+// In-process decoders for the common sound formats. They decode a whole file
+// straight into interleaved stereo float frames at the file's own sample rate,
+// without the media pipeline QAudioDecoder sets up per file. Anything they
+// don't understand is left to QAudioDecoder (see SampleLoader).
+class NativeDecoders
+{
+public:
+    enum Format {
+        Unknown,
+        Wav,
+        Flac,
+        Mp3
+    };
+
+    //identify the container from the first bytes of the file
+    static Format detect(const QByteArray &data);
+
+    //true if 'format' can be decoded in-process in this build
+    static bool supports(Format format);
+
+    //decode 'data' into 'sample' (data, frames and sampleRate); returns false and fills error on failure
+    static bool decode(Format format, const QByteArray &data, Sample &sample, QString *error);
+
+private:
+    static bool decodeWav(const QByteArray &data, Sample &sample, QString *error);
+    static bool decodeFlac(const QByteArray &data, Sample &sample, QString *error);
+    static bool decodeMp3(const QByteArray &data, Sample &sample, QString *error);
+};
+
+#endif // NATIVEDECODERS_H
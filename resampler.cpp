@@ -0,0 +1,152 @@
+#include "resampler.h"
+#include "mixkernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#define MAX_PHASES 2048 // Rates with a finer ratio snap to the nearest of this many phases
+
+namespace {
+
+const double Pi = 3.14159265358979323846;
+
+struct QualityParams {
+    int taps;
+    double rolloff; // passband edge as a fraction of the lower Nyquist
+    double beta;    // Kaiser window shape
+};
+
+QualityParams qualityParams(Resampler::Quality quality)
+{
+    switch (quality) {
+    case Resampler::Fast:     return {16, 0.85, 6.0};
+    case Resampler::Balanced: return {32, 0.91, 8.0};
+    default:                  return {64, 0.95, 10.0};
+    }
+}
+
+// Zeroth-order modified Bessel function of the first kind, for the Kaiser window.
+double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+// sum of src[i] * coefs[i] over 'count' floats, with the left and right
+// channels of interleaved stereo kept apart (coefs hold every tap twice)
+inline void stereoDot(const float *src, const float *coefs, int count, float &left, float &right)
+{
+    int i = 0;
+#if defined(MIXKERNELS_SSE)
+    __m128 a = _mm_setzero_ps(), b = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(src + i), _mm_loadu_ps(coefs + i)));
+        b = _mm_add_ps(b, _mm_mul_ps(_mm_loadu_ps(src + i + 4), _mm_loadu_ps(coefs + i + 4)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(a, b));
+    left = lanes[0] + lanes[2];
+    right = lanes[1] + lanes[3];
+#elif defined(MIXKERNELS_NEON)
+    float32x4_t a = vdupq_n_f32(0.0f), b = vdupq_n_f32(0.0f);
+    for (; i + 8 <= count; i += 8) {
+        a = vmlaq_f32(a, vld1q_f32(src + i), vld1q_f32(coefs + i));
+        b = vmlaq_f32(b, vld1q_f32(src + i + 4), vld1q_f32(coefs + i + 4));
+    }
+    const float32x4_t sum = vaddq_f32(a, b);
+    left = vgetq_lane_f32(sum, 0) + vgetq_lane_f32(sum, 2);
+    right = vgetq_lane_f32(sum, 1) + vgetq_lane_f32(sum, 3);
+#else
+    left = right = 0.0f;
+#endif
+    for (; i < count; i += 2) {
+        left += src[i] * coefs[i];
+        right += src[i + 1] * coefs[i + 1];
+    }
+}
+
+} // namespace
+
+qint64 Resampler::outputFrames(qint64 frames, int inRate, int outRate){
+    return (frames * outRate + inRate - 1) / inRate;
+}
+
+QVector<float> Resampler::convert(const float *input, qint64 frames, int inRate, int outRate, Quality quality){
+    if (inRate == outRate || inRate <= 0 || outRate <= 0 || frames == 0)
+        return QVector<float>(input, input + frames * 2);
+
+    const QualityParams params = qualityParams(quality);
+    const int taps = params.taps;
+    const int half = taps / 2;
+
+    //output frame n sits at input position n * M / L
+    const int divisor = std::gcd(inRate, outRate);
+    qint64 up = outRate / divisor;   // L
+    qint64 down = inRate / divisor;  // M
+    const bool exact = up <= MAX_PHASES;
+    const int phases = exact ? int(up) : MAX_PHASES;
+
+    //one filter per phase, every tap stored twice to match interleaved stereo;
+    //downsampling moves the cutoff below the output Nyquist
+    const double cutoff = params.rolloff * std::min(1.0, double(outRate) / inRate);
+    const double windowNorm = besselI0(params.beta);
+    QVector<float> filters(qsizetype(phases) * taps * 2);
+    for (int p = 0; p < phases; p++) {
+        const double offset = double(p) / phases;
+        float *filter = filters.data() + qsizetype(p) * taps * 2;
+        double sum = 0.0;
+        for (int k = 0; k < taps; k++) {
+            const double distance = (k - half + 1) - offset;
+            const double x = Pi * cutoff * distance;
+            const double sinc = distance == 0.0 ? 1.0 : std::sin(x) / x;
+            const double position = distance / half;
+            const double window = std::abs(position) >= 1.0 ? 0.0 : besselI0(params.beta * std::sqrt(1.0 - position * position)) / windowNorm;
+            filter[k * 2] = float(sinc * window);
+            sum += sinc * window;
+        }
+        //unity gain at DC for every phase
+        for (int k = 0; k < taps; k++)
+            filter[k * 2] = filter[k * 2 + 1] = float(filter[k * 2] / sum);
+    }
+
+    //pad the input so every tap window is inside the buffer
+    QVector<float> padded((frames + taps + 1) * 2, 0.0f);
+    std::copy_n(input, frames * 2, padded.data() + (half - 1) * 2);
+
+    const qint64 outFrames = outputFrames(frames, inRate, outRate);
+    QVector<float> output(outFrames * 2);
+    float *out = output.data();
+    const float *src = padded.constData();
+
+    if (exact) {
+        //integer stepping: index and phase advance by M / L without drift
+        qint64 index = 0, phase = 0;
+        for (qint64 n = 0; n < outFrames; n++) {
+            stereoDot(src + index * 2, filters.constData() + phase * taps * 2, taps * 2, out[n * 2], out[n * 2 + 1]);
+            phase += down;
+            index += phase / up;
+            phase %= up;
+        }
+    }
+    else {
+        const double step = double(inRate) / outRate;
+        for (qint64 n = 0; n < outFrames; n++) {
+            const double position = n * step;
+            qint64 index = qint64(position);
+            qint64 phase = qint64(std::lround((position - index) * phases));
+            if (phase == phases) {
+                index++;
+                phase = 0;
+            }
+            stereoDot(src + index * 2, filters.constData() + phase * taps * 2, taps * 2, out[n * 2], out[n * 2 + 1]);
+        }
+    }
+    return output;
+}
@@ -0,0 +1,26 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <QVector>
+
+// Band-limited sample rate conversion for whole sounds, done once when a
+// sound is loaded so playback never resamples.
+// The ratio is reduced to L/M and the Kaiser-windowed sinc is split into L
+// phases; every output frame is one dot product of a phase with the input.
+class Resampler
+{
+public:
+    enum Quality {
+        Fast,     // 16 taps, for quick previews on slow machines
+        Balanced, // 32 taps
+        Best      // 64 taps, ~100 dB stopband
+    };
+
+    //convert 'frames' interleaved stereo frames from inRate to outRate
+    static QVector<float> convert(const float *input, qint64 frames, int inRate, int outRate, Quality quality);
+
+    //number of output frames convert() produces
+    static qint64 outputFrames(qint64 frames, int inRate, int outRate);
+};
+
+#endif // RESAMPLER_H
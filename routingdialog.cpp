@@ -0,0 +1,53 @@
+#include "routingdialog.h"
+
+#include <QFileInfo>
+
+RoutingDialog::RoutingDialog(const QStringList &soundFiles, const QList<QList<int>> &routes, QWidget *parent)
+    : QDialog(parent)
+{
+    //set the dialog title
+    setWindowTitle("Sound Routing");
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    QLabel *help = new QLabel(tr("Set how loud each sound plays on each output.\n0 % keeps a sound off that output entirely (e.g. cues only you should hear)."), this);
+    layout->addWidget(help);
+
+    //one row per sound, one column per output
+    QGridLayout *grid = new QGridLayout();
+    grid->addWidget(new QLabel(tr("<b>Sound</b>"), this), 0, 0);
+    grid->addWidget(new QLabel(tr("<b>Output One</b>"), this), 0, 1);
+    grid->addWidget(new QLabel(tr("<b>Output Two</b>"), this), 0, 2);
+
+    for (int slot = 0; slot < routes.size(); slot++) {
+        QString name = slot < soundFiles.size() ? QFileInfo(soundFiles[slot]).fileName() : QString();
+        QLabel *label = new QLabel(QString("%1. %2").arg(slot + 1).arg(name.isEmpty() ? tr("(none)") : name), this);
+        label->setToolTip(slot < soundFiles.size() ? soundFiles[slot] : QString());
+        grid->addWidget(label, slot + 1, 0);
+
+        for (int bus = 0; bus < routes[slot].size(); bus++) {
+            QSpinBox *gain = new QSpinBox(this);
+            gain->setRange(0, 200);
+            gain->setSuffix(" %");
+            gain->setValue(routes[slot][bus]);
+            grid->addWidget(gain, slot + 1, bus + 1);
+            connect(gain, &QSpinBox::valueChanged, this, [this, slot, bus](int value){
+                emit routeChanged(slot, bus, value);
+            });
+        }
+    }
+
+    //the rows scroll on boards with many slots
+    QWidget *rows = new QWidget(this);
+    rows->setLayout(grid);
+    QScrollArea *scroll = new QScrollArea(this);
+    scroll->setWidget(rows);
+    scroll->setWidgetResizable(true);
+    scroll->setFrameShape(QFrame::NoFrame);
+    layout->addWidget(scroll);
+
+    //OK button to close the dialog
+    QPushButton *okButton = new QPushButton("OK", this);
+    connect(okButton, &QPushButton::clicked, this, &QDialog::accept);
+    layout->addWidget(okButton);
+}
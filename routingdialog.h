@@ -0,0 +1,25 @@
+#ifndef ROUTINGDIALOG_H
+#define ROUTINGDIALOG_H
+
+#include <QGridLayout>
+#include <QVBoxLayout>
+#include <QPushButton>
+#include <QScrollArea>
+#include <QStringList>
+#include <QSpinBox>
+#include <QDialog>
+#include <QWidget>
+#include <QLabel>
+
+//lets the user choose how loud each sound is on each output (the routing matrix)
+class RoutingDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit RoutingDialog(const QStringList &soundFiles, const QList<QList<int>> &routes, QWidget *parent = nullptr);
+
+signals:
+    void routeChanged(int slot, int bus, int percent);
+};
+
+#endif // ROUTINGDIALOG_H
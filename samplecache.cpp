@@ -0,0 +1,152 @@
+#include "samplecache.h"
+#include "audiomanager.h"
+#include "samplepool.h"
+
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QDir>
+
+#include <cstring>
+
+#define CACHE_MAGIC "USBPCM03" // 03: content hashes are BLAKE2b, entries with the old seeded hash are dropped
+#define CACHE_HASH_SIZE 24 // SamplePool::hash()
+#define CACHE_HEAD_MS 300 // Start of every mapped sample kept in RAM (see Sample::headFrames)
+
+// Laid out at the start of every cache file; the frames follow at 'dataOffset'.
+struct SampleCache::Header {
+    char magic[8];
+    quint32 headerSize;  // sizeof(Header), doubles as a layout/version check
+    qint32 sampleRate;
+    qint32 channels;
+    qint32 quality;
+    qint64 frames;
+    qint64 sourceSize;
+    qint64 sourceModified; // ms since epoch
+    char contentHash[CACHE_HASH_SIZE]; // of the source file
+    quint32 dataOffset;
+};
+
+QString SampleCache::directory(){
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/pcm";
+}
+
+//one cache file per source path and rate, so moving between devices that run
+//at different rates doesn't throw the other entry away
+QString SampleCache::cacheFile(const QString &path, int rate){
+    const QByteArray name = QFileInfo(path).absoluteFilePath().toUtf8() + '@' + QByteArray::number(rate);
+    const QByteArray key = QCryptographicHash::hash(name, QCryptographicHash::Sha1).toHex();
+    return directory() + "/" + QString::fromLatin1(key) + ".pcm";
+}
+
+QByteArray SampleCache::contentHash(const QString &path){
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return SamplePool::hash(file.readAll());
+}
+
+//open the entry for 'path' and check it still matches the source; leaves 'header' filled in
+bool SampleCache::openEntry(const QString &path, int quality, int rate, QFile &file, Header &header){
+    const QFileInfo source(path);
+    file.setFileName(cacheFile(path, rate));
+    if (!source.exists() || !file.open(QIODevice::ReadOnly))
+        return false;
+
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != qint64(sizeof(header))
+        || std::memcmp(header.magic, CACHE_MAGIC, 8) != 0
+        || header.headerSize != sizeof(Header)
+        || header.dataOffset < sizeof(Header)
+        || header.sampleRate != rate
+        || header.channels != CHANNELS
+        || header.quality != quality
+        || header.frames <= 0
+        || file.size() < header.dataOffset + header.frames * CHANNELS * qint64(sizeof(float)))
+        return false;
+
+    //size and mtime decide the common case without reading the source; if they
+    //moved (copied, touched, restored from backup), the content hash decides
+    const qint64 modified = source.lastModified().toMSecsSinceEpoch();
+    if (header.sourceSize != source.size() || header.sourceModified != modified) {
+        const QByteArray hash = contentHash(path);
+        if (hash.size() != CACHE_HASH_SIZE || std::memcmp(hash.constData(), header.contentHash, CACHE_HASH_SIZE) != 0)
+            return false;
+
+        //same content: refresh the stamps so the next start skips the hash
+        QFile update(file.fileName());
+        if (update.open(QIODevice::ReadWrite)) {
+            header.sourceSize = source.size();
+            header.sourceModified = modified;
+            update.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        }
+    }
+    return true;
+}
+
+QByteArray SampleCache::contentKey(const QString &path, int quality, int rate){
+    QFile file;
+    Header header;
+    if (!openEntry(path, quality, rate, file, header))
+        return QByteArray();
+    return QByteArray(header.contentHash, CACHE_HASH_SIZE);
+}
+
+SamplePtr SampleCache::load(const QString &path, int quality, int rate){
+    auto file = std::make_shared<QFile>();
+    Header header;
+    if (!openEntry(path, quality, rate, *file, header))
+        return nullptr;
+    const qint64 bytes = header.frames * CHANNELS * qint64(sizeof(float));
+
+    uchar *memory = file->map(header.dataOffset, bytes);
+    if (!memory)
+        return nullptr;
+
+    SamplePtr sample = std::make_shared<Sample>();
+    sample->mapped = reinterpret_cast<const float *>(memory);
+    sample->mapping = file; //unmapped and closed with the last reference
+    sample->frames = header.frames;
+    sample->sampleRate = header.sampleRate;
+
+    //keep the start resident so a trigger never waits for the first pages
+    sample->headFrames = std::min<qint64>(header.frames, qint64(CACHE_HEAD_MS) * header.sampleRate / 1000);
+    sample->data = QVector<float>(sample->mapped, sample->mapped + sample->headFrames * CHANNELS);
+
+    return sample;
+}
+
+bool SampleCache::store(const QString &path, int quality, const QByteArray &hash, const Sample &sample){
+    if (sample.frames <= 0 || sample.sampleRate <= 0 || hash.size() != CACHE_HASH_SIZE || !QDir().mkpath(directory()))
+        return false;
+
+    const QFileInfo source(path);
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CACHE_MAGIC, 8);
+    header.headerSize = sizeof(Header);
+    header.sampleRate = sample.sampleRate;
+    header.channels = CHANNELS;
+    header.quality = quality;
+    header.frames = sample.frames;
+    header.sourceSize = source.size();
+    header.sourceModified = source.lastModified().toMSecsSinceEpoch();
+    std::memcpy(header.contentHash, hash.constData(), CACHE_HASH_SIZE);
+    header.dataOffset = sizeof(Header);
+
+    //QSaveFile so a crash mid-write never leaves a truncated entry behind
+    QSaveFile file(cacheFile(path, sample.sampleRate));
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(sample.frame(0)), sample.frames * CHANNELS * qint64(sizeof(float)));
+    if (!file.commit()) {
+        qDebug() << "Could not write the sound cache for" << path << ":" << file.errorString();
+        return false;
+    }
+    return true;
+}
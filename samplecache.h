@@ -0,0 +1,40 @@
+#ifndef SAMPLECACHE_H
+#define SAMPLECACHE_H
+
+#include "audiosample.h"
+
+#include <QByteArray>
+#include <QString>
+
+class QFile;
+
+// Persistent cache of decoded sounds under QStandardPaths::CacheLocation.
+// Each source file gets one cache file per engine rate holding its frames as
+// stereo float at that rate, behind a header that records what it was made from. Hits are
+// memory-mapped rather than read, so startup with an unchanged library costs
+// a stat and an mmap per sound and only the touched pages are ever read.
+// Mapped samples stream (see Sample); only their head is copied into RAM.
+class SampleCache
+{
+public:
+    //the cached sample for 'path' at 'quality' and 'rate', or nullptr if there is none or it is stale
+    static SamplePtr load(const QString &path, int quality, int rate);
+
+    //the content hash recorded for 'path' if its entry is valid, without mapping anything
+    static QByteArray contentKey(const QString &path, int quality, int rate);
+
+    //write 'sample' (at an engine rate) to the cache for 'path', whose contents hash to 'hash';
+    //failures only cost the next startup a decode
+    static bool store(const QString &path, int quality, const QByteArray &hash, const Sample &sample);
+
+    static QString directory();
+
+private:
+    struct Header;
+
+    static QString cacheFile(const QString &path, int rate);
+    static QByteArray contentHash(const QString &path);
+    static bool openEntry(const QString &path, int quality, int rate, QFile &file, Header &header);
+};
+
+#endif // SAMPLECACHE_H
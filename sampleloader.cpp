@@ -0,0 +1,229 @@
+#include "sampleloader.h"
+#include "audiomanager.h"
+#include "nativedecoders.h"
+#include "samplecache.h"
+#include "samplepool.h"
+#include "startupprofile.h"
+
+#include <QAudioDecoder>
+#include <QAudioFormat>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QDebug>
+#include <QFile>
+#include <QUrl>
+
+#include <algorithm>
+#include <cmath>
+
+#define TRIM_PREROLL_MS 5 // Kept before the first audible frame so soft attacks aren't clipped
+#define TRIM_TAIL_MS 20 // Kept after the last audible frame for reverb tails and decays
+
+std::atomic<Resampler::Quality> SampleLoader::resampleQuality{Resampler::Best};
+std::atomic<int> SampleLoader::engineRate{SAMPLE_RATE};
+
+SamplePtr SampleLoader::load(const QString &path, Residency residency, Resampler::Quality quality, QString *error){
+    if (!QFileInfo::exists(path)) {
+        if (error) *error = QString("File \"%1\" does not exist.").arg(path);
+        return nullptr;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QString name = QFileInfo(path).fileName();
+
+    //identical audio (the same clip in several slots or configs) is shared through
+    //the pool; the key is the content hash plus the rate, resampling quality and residency
+    const qint32 rate = targetRate();
+    QByteArray suffix(reinterpret_cast<const char *>(&rate), sizeof(rate));
+    suffix.append(char(quality));
+    suffix.append(char(residency));
+
+    //a sound decoded on an earlier run is mapped straight from the cache, and its
+    //hash comes from the cache entry without reading the source
+    //(SOUNDBOARD_NO_CACHE bypasses the cache, e.g. to time the decoders)
+    const bool useCache = !qEnvironmentVariableIsSet("SOUNDBOARD_NO_CACHE");
+    if (useCache) {
+        const QByteArray hash = SampleCache::contentKey(path, quality, rate);
+        if (!hash.isEmpty()) {
+            if (SamplePtr shared = SamplePool::find(hash + suffix)) {
+                qCDebug(lcTiming) << "Shared" << name << "with an already loaded sound";
+                return shared;
+            }
+            if (SamplePtr cached = SampleCache::load(path, quality, rate)) {
+                if (residency == Residency::Resident)
+                    cached = makeResident(*cached);
+                qCDebug(lcTiming) << "Mapped" << name << "from the cache in" << timer.nsecsElapsed() / 1000 << "us";
+                return SamplePool::insert(hash + suffix, cached);
+            }
+        }
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString("Could not read \"%1\": %2").arg(path, file.errorString());
+        return nullptr;
+    }
+    const QByteArray data = file.readAll();
+    const QByteArray hash = SamplePool::hash(data);
+    if (SamplePtr shared = SamplePool::find(hash + suffix)) {
+        qCDebug(lcTiming) << "Shared" << name << "with an already loaded sound";
+        return shared;
+    }
+
+    //WAV, FLAC and (with libmpg123) MP3 are decoded in-process; everything else,
+    //and any file the native decoders reject, goes through QAudioDecoder.
+    //Setting SOUNDBOARD_QT_DECODER forces the QAudioDecoder path for comparison.
+    SamplePtr sample;
+    const char *decoder = "QAudioDecoder";
+    const NativeDecoders::Format format = NativeDecoders::detect(data);
+    if (!qEnvironmentVariableIsSet("SOUNDBOARD_QT_DECODER") && NativeDecoders::supports(format)) {
+        sample = std::make_shared<Sample>();
+        QString nativeError;
+        if (NativeDecoders::decode(format, data, *sample, &nativeError)) {
+            decoder = "native";
+        }
+        else {
+            qWarning() << "Native decoder failed for" << path << ":" << nativeError;
+            sample = nullptr;
+        }
+    }
+    if (!sample)
+        sample = decodeWithQt(path, error);
+    if (!sample)
+        return nullptr;
+
+    const qint64 decodeTime = timer.nsecsElapsed() / 1000;
+    const int sourceRate = sample->sampleRate;
+    convertRate(*sample, rate, quality);
+    qCDebug(lcTiming) << "Decoded" << name << "in" << decodeTime << "us (" << decoder << "), resampled"
+             << sourceRate << "->" << rate << "in" << timer.nsecsElapsed() / 1000 - decodeTime << "us";
+
+    //a streaming sound drops its decoded copy once the cache holds it
+    if (useCache && SampleCache::store(path, quality, hash, *sample) && residency == Residency::Streaming) {
+        if (SamplePtr streamed = SampleCache::load(path, quality, rate))
+            sample = streamed;
+    }
+    return SamplePool::insert(hash + suffix, sample);
+}
+
+//copy a mapped sample entirely into RAM
+SamplePtr SampleLoader::makeResident(const Sample &mapped){
+    SamplePtr sample = std::make_shared<Sample>();
+    sample->data = QVector<float>(mapped.mapped, mapped.mapped + mapped.frames * CHANNELS);
+    sample->frames = mapped.frames;
+    sample->sampleRate = mapped.sampleRate;
+    return sample;
+}
+
+void SampleLoader::setResampleQuality(Resampler::Quality quality){
+    resampleQuality.store(quality, std::memory_order_relaxed);
+}
+
+Resampler::Quality SampleLoader::quality(){
+    return resampleQuality.load(std::memory_order_relaxed);
+}
+
+void SampleLoader::setTargetRate(int rate){
+    engineRate.store(rate, std::memory_order_relaxed);
+}
+
+int SampleLoader::targetRate(){
+    return engineRate.load(std::memory_order_relaxed);
+}
+
+// A single scan from each end; the middle of the sound is never read. On a
+// streaming sample the backward scan touches only the last mapped pages.
+void SampleLoader::findAudibleRange(const Sample &sample, float thresholdDb, qint64 &start, qint64 &end){
+    const float threshold = std::pow(10.0f, thresholdDb / 20.0f);
+    auto audible = [&](qint64 index) {
+        const float *frame = sample.frame(index);
+        return std::fabs(frame[0]) > threshold || std::fabs(frame[1]) > threshold;
+    };
+
+    qint64 first = 0;
+    while (first < sample.frames && !audible(first))
+        first++;
+    if (first == sample.frames) {
+        start = 0;
+        end = sample.frames;
+        return;
+    }
+    qint64 last = sample.frames - 1;
+    while (last > first && !audible(last))
+        last--;
+
+    start = std::max<qint64>(0, first - qint64(TRIM_PREROLL_MS) * sample.sampleRate / 1000);
+    end = std::min(sample.frames, last + 1 + qint64(TRIM_TAIL_MS) * sample.sampleRate / 1000);
+}
+
+//bring a decoded sample to the rate the engine's streams run at, once, so playback never resamples
+void SampleLoader::convertRate(Sample &sample, int rate, Resampler::Quality quality){
+    if (sample.sampleRate != rate && sample.sampleRate > 0 && sample.frames > 0) {
+        sample.data = Resampler::convert(sample.data.constData(), sample.frames, sample.sampleRate, rate, quality);
+        sample.frames = sample.data.size() / CHANNELS;
+    }
+    sample.sampleRate = rate;
+}
+
+//decode through QAudioDecoder at the file's own rate; convertRate() does the rate conversion
+SamplePtr SampleLoader::decodeWithQt(const QString &path, QString *error){
+    QAudioDecoder decoder;
+    decoder.setSource(QUrl::fromLocalFile(path));
+
+    SamplePtr sample = std::make_shared<Sample>();
+    QString decodeError;
+    QEventLoop loop;
+
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, &loop, [&](){
+        const QAudioBuffer buffer = decoder.read();
+        if (!buffer.isValid())
+            return;
+        if (sample->sampleRate == 0)
+            sample->sampleRate = buffer.format().sampleRate();
+        appendBuffer(buffer, sample->data);
+    });
+    QObject::connect(&decoder, &QAudioDecoder::finished, &loop, &QEventLoop::quit);
+    QObject::connect(&decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), &loop, [&](QAudioDecoder::Error){
+        decodeError = decoder.errorString();
+        loop.quit();
+    });
+
+    decoder.start();
+    loop.exec();
+
+    if (!decodeError.isEmpty() || sample->data.isEmpty()) {
+        if (error) *error = decodeError.isEmpty() ? QString("No audio could be decoded from \"%1\".").arg(path) : decodeError;
+        return nullptr;
+    }
+
+    sample->frames = sample->data.size() / CHANNELS;
+    return sample;
+}
+
+//convert a decoded buffer of any sample format/channel count into interleaved stereo float
+void SampleLoader::appendBuffer(const QAudioBuffer &buffer, QVector<float> &out){
+    const QAudioFormat format = buffer.format();
+    const int channels = format.channelCount();
+    const int bytesPerSample = format.bytesPerSample();
+    const qsizetype frames = buffer.frameCount();
+    const char *data = buffer.constData<char>();
+
+    const qsizetype start = out.size();
+    out.resize(start + frames * CHANNELS);
+    float *dst = out.data() + start;
+
+    if (format.sampleFormat() == QAudioFormat::Float && channels == CHANNELS) {
+        std::copy_n(buffer.constData<float>(), frames * CHANNELS, dst);
+        return;
+    }
+
+    for (qsizetype f = 0; f < frames; f++) {
+        const char *frame = data + f * channels * bytesPerSample;
+        const float left = format.normalizedSampleValue(frame);
+        const float right = channels > 1 ? format.normalizedSampleValue(frame + bytesPerSample) : left;
+        dst[f * 2] = left;
+        dst[f * 2 + 1] = right;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef SAMPLELOADER_H
+#define SAMPLELOADER_H
+
+#include "audiosample.h"
+#include "resampler.h"
+
+#include <QAudioBuffer>
+#include <QString>
+
+#include <atomic>
+
+// Decodes sound files into Samples the audio engine can mix directly.
+class SampleLoader
+{
+public:
+    // Resident keeps every frame in RAM. Streaming keeps only the head in RAM and
+    // maps the rest from the disk cache (falling back to Resident without one).
+    enum class Residency {
+        Resident,
+        Streaming
+    };
+
+    //decode the file at path into stereo float frames converted to the engine rate with
+    //'quality'; returns nullptr and fills error on failure
+    static SamplePtr load(const QString &path, Residency residency, Resampler::Quality quality, QString *error = nullptr);
+
+    //quality of the conversion to the engine rate for sounds loaded from now on, unless a load asks for another
+    static void setResampleQuality(Resampler::Quality quality);
+    static Resampler::Quality quality();
+
+    //the rate sounds loaded from now on are converted to: the engine's (AudioManager::sampleRate())
+    static void setTargetRate(int rate);
+    static int targetRate();
+
+    //the frames [start, end) that rise above 'thresholdDb' on either channel, padded so
+    //attacks and tails survive; the whole sample if it never does
+    static void findAudibleRange(const Sample &sample, float thresholdDb, qint64 &start, qint64 &end);
+
+private:
+    static SamplePtr decodeWithQt(const QString &path, QString *error);
+    static void convertRate(Sample &sample, int rate, Resampler::Quality quality);
+    static void appendBuffer(const QAudioBuffer &buffer, QVector<float> &out);
+    static SamplePtr makeResident(const Sample &mapped);
+
+    static std::atomic<Resampler::Quality> resampleQuality;
+    static std::atomic<int> engineRate;
+};
+
+#endif // SAMPLELOADER_H
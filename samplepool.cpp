@@ -0,0 +1,60 @@
+#include "samplepool.h"
+#include "audiomanager.h"
+
+#include <QCryptographicHash>
+#include <QMutexLocker>
+
+QMutex SamplePool::mutex;
+QHash<QByteArray, std::weak_ptr<Sample>> SamplePool::samples;
+
+// BLAKE2b-128 of the contents, plus the length. Unlike qHashBits, which mixes
+// in a seed that is random in every process, it is the same on every run and
+// every machine, so it can be stored in the disk cache and the loudness index.
+QByteArray SamplePool::hash(const QByteArray &data){
+    const quint64 size = quint64(data.size());
+    return QCryptographicHash::hash(data, QCryptographicHash::Blake2b_128)
+           + QByteArray(reinterpret_cast<const char *>(&size), sizeof(size));
+}
+
+SamplePtr SamplePool::find(const QByteArray &key){
+    QMutexLocker locker(&mutex);
+    auto it = samples.constFind(key);
+    return it == samples.constEnd() ? nullptr : it->lock();
+}
+
+SamplePtr SamplePool::insert(const QByteArray &key, SamplePtr sample){
+    QMutexLocker locker(&mutex);
+    std::weak_ptr<Sample> &entry = samples[key];
+    if (SamplePtr existing = entry.lock())
+        return existing;
+    entry = sample;
+
+    //drop entries whose samples are gone while we hold the lock anyway
+    for (auto it = samples.begin(); it != samples.end(); ) {
+        if (it->expired())
+            it = samples.erase(it);
+        else
+            ++it;
+    }
+    return sample;
+}
+
+SamplePool::Stats SamplePool::stats(){
+    QMutexLocker locker(&mutex);
+    Stats stats;
+    for (const std::weak_ptr<Sample> &entry : std::as_const(samples)) {
+        //use_count() of the weak reference counts the owners without adding one
+        const long owners = entry.use_count();
+        if (owners == 0)
+            continue;
+        SamplePtr sample = entry.lock();
+        if (!sample)
+            continue;
+        const qint64 bytes = sample->frames * CHANNELS * qint64(sizeof(float));
+        stats.references += int(owners);
+        stats.uniqueSamples++;
+        stats.logicalBytes += bytes * owners;
+        stats.residentBytes += bytes;
+    }
+    return stats;
+}
@@ -0,0 +1,45 @@
+#ifndef SAMPLEPOOL_H
+#define SAMPLEPOOL_H
+
+#include "audiosample.h"
+
+#include <QByteArray>
+#include <QMutex>
+#include <QHash>
+
+#include <memory>
+
+// Content-addressed registry of every loaded sample, so the same audio used
+// by several slots (or by several configs in one session) is held in memory
+// once. The pool only holds weak references; a sample lives exactly as long
+// as some slot still uses it.
+class SamplePool
+{
+public:
+    struct Stats {
+        int references = 0;     // slots/owners holding a pooled sample
+        int uniqueSamples = 0;  // distinct samples actually in memory
+        qint64 logicalBytes = 0;  // what the references would cost without sharing
+        qint64 residentBytes = 0; // what they do cost
+
+        qint64 bytesSaved() const { return logicalBytes - residentBytes; }
+        double ratio() const { return residentBytes ? double(logicalBytes) / residentBytes : 1.0; }
+    };
+
+    //128-bit hash of a file's contents (24 bytes with the length); the same on every run
+    static QByteArray hash(const QByteArray &data);
+
+    //the live sample stored under 'key', or nullptr
+    static SamplePtr find(const QByteArray &key);
+
+    //register 'sample' under 'key' and return the pooled sample (an existing one wins)
+    static SamplePtr insert(const QByteArray &key, SamplePtr sample);
+
+    static Stats stats();
+
+private:
+    static QMutex mutex;
+    static QHash<QByteArray, std::weak_ptr<Sample>> samples;
+};
+
+#endif // SAMPLEPOOL_H
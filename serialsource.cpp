@@ -0,0 +1,97 @@
+#include "serialsource.h"
+
+#include <QDebug>
+
+SerialSource::SerialSource(TriggerQueue *queue, QObject *parent)
+    : TriggerSource("serial", queue, parent)
+{
+    context = new QObject;
+    port = new QSerialPort(context);
+    device = new DeviceProtocol(context);
+
+    //scans are read and presses played on the source thread
+    connect(port, &QSerialPort::readyRead, context, [this](){
+        while (port->canReadLine())
+            device->feed(QString(port->readLine().trimmed()));
+    });
+    connect(device, &DeviceProtocol::buttonPressed, context, [this](int button){ trigger(button); });
+
+    //everything else is the owner's business
+    connect(device, &DeviceProtocol::boardReported, this, &SerialSource::boardReported);
+    connect(device, &DeviceProtocol::buttonsSeen, this, &SerialSource::buttonsSeen);
+    connect(device, &DeviceProtocol::bankStepRequested, this, &SerialSource::bankStepRequested);
+    connect(port, &QSerialPort::errorOccurred, this, &SerialSource::errorOccurred);
+
+    context->moveToThread(this);
+    //deferred deletes still run once the thread's event loop has stopped
+    connect(this, &QThread::finished, context, &QObject::deleteLater);
+    start();
+}
+
+SerialSource::~SerialSource(){
+    stop();
+}
+
+bool SerialSource::open(const QString &portName, int baudRate, QSerialPort::SerialPortError *error){
+    bool ok = false;
+    QMetaObject::invokeMethod(context, [&](){
+        if (port->isOpen()) port->close();
+        port->setPortName(portName);
+        port->setBaudRate(baudRate);
+        port->setDataBits(QSerialPort::Data8);
+        port->setParity(QSerialPort::NoParity);
+        port->setStopBits(QSerialPort::OneStop);
+        port->setFlowControl(QSerialPort::NoFlowControl);
+        ok = port->open(QIODevice::ReadWrite);
+        *error = port->error();
+        if (!ok) return;
+        port->setDataTerminalReady(true); //prevent arduino resets
+        port->setRequestToSend(true);
+
+        //a new connection starts from scratch: ask the device how many buttons
+        //it has and which led sits under each
+        device->reset();
+        port->write("?\n");
+    }, Qt::BlockingQueuedConnection);
+    opened = ok;
+    if (ok) openedPort = portName;
+    return ok;
+}
+
+void SerialSource::close(){
+    QMetaObject::invokeMethod(context, [this](){
+        if (port->isOpen()) port->close();
+    }, Qt::BlockingQueuedConnection);
+    opened = false;
+}
+
+bool SerialSource::isOpen() const {
+    return opened;
+}
+
+QString SerialSource::portName() const {
+    return openedPort;
+}
+
+void SerialSource::setBankButtons(const QList<int> &previousBank, const QList<int> &nextBank){
+    QMetaObject::invokeMethod(context, [this, previousBank, nextBank](){
+        device->setBankButtons(previousBank, nextBank);
+    });
+}
+
+void SerialSource::setLedTable(const QList<int> &leds){
+    slotLeds = leds;
+    QMetaObject::invokeMethod(context, [this, leds](){ device->setLedTable(leds); });
+}
+
+const QList<int> &SerialSource::ledTable() const {
+    return slotLeds;
+}
+
+void SerialSource::setLed(int slot, bool on){
+    QMetaObject::invokeMethod(context, [this, slot, on](){
+        const QString message = device->setLed(slot, on);
+        if (!message.isEmpty() && port->isOpen() && port->isWritable())
+            port->write(message.toUtf8());
+    });
+}
@@ -0,0 +1,54 @@
+#ifndef SERIALSOURCE_H
+#define SERIALSOURCE_H
+
+#include "triggersource.h"
+#include "deviceprotocol.h"
+
+#include <QtSerialPort/QSerialPort>
+#include <QString>
+#include <QList>
+
+#include <atomic>
+
+// The soundboard's own device on a serial port. The port and the protocol
+// live on the source's thread, so button scans are read and debounced and
+// presses are played there; the owner only hears about what it has to act
+// on (the board's size, bank steps, errors), through queued signals. The
+// thread runs from construction.
+class SerialSource : public TriggerSource
+{
+    Q_OBJECT
+public:
+    explicit SerialSource(TriggerQueue *queue, QObject *parent = nullptr);
+    ~SerialSource();
+
+    // Owner thread. open() and close() wait for the source thread; open()
+    // asks the device what it is ("?") once it is connected.
+    bool open(const QString &portName, int baudRate, QSerialPort::SerialPortError *error);
+    void close();
+    bool isOpen() const;
+    QString portName() const; // the port last opened
+
+    // Owner thread, applied on the source thread in order.
+    void setBankButtons(const QList<int> &previousBank, const QList<int> &nextBank);
+    void setLedTable(const QList<int> &leds);
+    const QList<int> &ledTable() const;
+    void setLed(int slot, bool on);
+
+signals:
+    // Received on the owner thread.
+    void boardReported(int buttons, const QList<int> &leds);
+    void buttonsSeen(int buttons);
+    void bankStepRequested(int step, const QList<int> &buttons);
+    void errorOccurred(QSerialPort::SerialPortError error);
+
+private:
+    QObject *context;           // lives on the source thread; owns the port and the protocol
+    QSerialPort *port;
+    DeviceProtocol *device;
+    QString openedPort;
+    QList<int> slotLeds;        // the owner's copy of the led table
+    std::atomic<bool> opened{false};
+};
+
+#endif // SERIALSOURCE_H
@@ -3,8 +3,22 @@
 Soundboard::Soundboard(QWidget *parent)
     : QMainWindow{parent}
 {
+    //only what the window needs is done here; everything else starts once it
+    //is up (see startSubsystems)
+    StartupProfile::begin("init data");
     //load initialization data from "init.json" if it exists
     loadInitData();
+    StartupProfile::end("init data");
+    StartupProfile::begin("window");
+
+    //saves the loaded config once its settings have been left alone for a moment
+    autosaveTimer = new QTimer(this);
+    autosaveTimer->setSingleShot(true);
+    autosaveTimer->setInterval(AUTOSAVE_DELAY_MS);
+    connect(autosaveTimer, &QTimer::timeout, this, [this](){
+        if(loadedConfig != "" && configDirty && !writeConfig(loadedConfig))
+            qDebug() << "Autosave of" << loadedConfig << "failed";
+    });
 
     //create a system tray icon
     trayIcon = new QSystemTrayIcon(QIcon(":/icons/icon.ico"), this);
@@ -38,49 +52,128 @@ Soundboard::Soundboard(QWidget *parent)
         }
     });
 
-    //the format the serial data should be sent/recieved in
-    serialData = "0|0|0|0|0|0|0|0|0|0\n";
-    oldSerialData = "0|0|0|0|0|0|0|0|0|0\n";
+    //initialize the audio engine. sounds are decoded up front and mixed by the
+    //engine into both outputs (and optionally the microphone) with no media players
+    audio = new AudioManager(this);
+    connect(audio, &AudioManager::voiceFinished, this, &Soundboard::soundEnd);
+    connect(audio, &AudioManager::sampleRateChanged, this, &Soundboard::sampleRateChanged);
+    connect(audio, &AudioManager::errorOccurred, this, [this](const QString &error){
+        QMessageBox::critical(this, tr("Error: AudioEngineError"), error);
+    });
 
-    //initialize the serial port object
-    serial = new QSerialPort(this);
+    //decides which sounds stay fully in RAM and which stream from the disk cache,
+    //ranked by how often and how recently each one is played
+    budget = new MemoryBudget(audio, this);
+    budget->setBudget(qint64(memoryBudgetMb) << 20);
+    budget->loadUsage(QCoreApplication::applicationDirPath()+"/usage.json");
+
+    //measures every sound's loudness in the background so they can all be
+    //played at the same level without touching the volume sliders
+    loudness = new LoudnessAnalyzer(this);
+    connect(loudness, &LoudnessAnalyzer::measured, this, &Soundboard::loudnessMeasured);
+
+    //decodes sounds on every core so loading a config never blocks the window
+    importer = new ImportPipeline(this);
+    connect(importer, &ImportPipeline::imported, this, &Soundboard::soundImported);
+    connect(importer, &ImportPipeline::progress, this, &Soundboard::importProgress);
+    connect(importer, &ImportPipeline::finished, this, &Soundboard::importFinished);
+
+    //reloads a sound in the background when it is edited in another program
+    watcher = new SoundWatcher(this);
+    connect(watcher, &SoundWatcher::filesChanged, this, &Soundboard::soundFilesChanged);
+
+    //lets other programs on this machine trigger sounds. it plays them through
+    //the engine on its own thread and only reports back what the window keeps
+    control = new ControlServer(audio, this);
+    connect(control, &ControlServer::played, this, [this](int slot){
+        if (slot >= soundFiles.size() || soundFiles[slot].isEmpty()) return;
+        budget->notePress(slot);
+        setLed(slot, true);
+    });
+    connect(control, &ControlServer::gainChanged, this, [this](int slot, int bus, int percent){
+        if (slot >= slotRoutes.size()) return;
+        slotRoutes[slot][bus] = percent;
+        markConfigDirty("routes");
+    });
+    connect(control, &ControlServer::bankRequested, this, [this](int bank){
+        if (bank < banks.size()) switchBank(bank);
+    });
+    connect(control, &ControlServer::bankStepRequested, this, [this](int step){
+        switchBank(currentBank + step);
+    });
 
-    //connect incoming serial data to our recieveSerialData slot
-    connect(serial, &QSerialPort::readyRead, this, &Soundboard::receiveSerialData);
+    //every input that triggers sounds (the device, keys, MIDI) is read on a
+    //thread of its own and plays its presses through the engine right there;
+    //the leds and play counts catch up here through the one queue they share
+    triggers = new TriggerQueue(audio, this);
+    connect(triggers, &TriggerQueue::pending, this, &Soundboard::handleTriggers);
+
+    //reads the button scans and builds the led messages; held combinations
+    //switch banks
+    serialSource = new SerialSource(triggers, this);
+    serialSource->setBankButtons(prevBankButtons, nextBankButtons);
+    connect(serialSource, &SerialSource::buttonsSeen, this, [this](int buttons){
+        if (buttons > soundFiles.size()) setSlotCount(buttons);
+    });
+    connect(serialSource, &SerialSource::boardReported, this, [this](int buttons, const QList<int> &leds){
+        setSlotCount(buttons);
+        if (!leds.isEmpty()) setLedTable(leds);
+    });
+    connect(serialSource, &SerialSource::bankStepRequested, this, [this](int step, const QList<int> &buttons){
+        //a sound already started by the first button of the combination is stopped
+        for (int button : buttons) audio->stopSlot(button);
+        switchBank(currentBank + step);
+    });
 
     //catch any errors related to the serial port
-    connect(serial, &QSerialPort::errorOccurred, this, [this](QSerialPort::SerialPortError error) {
+    connect(serialSource, &SerialSource::errorOccurred, this, [this](QSerialPort::SerialPortError error) {
         qDebug()<<"Serial Error: "<<error;
         serialError = error;
-        if(error != QSerialPort::NoError && serial->isOpen()){
+        if(error != QSerialPort::NoError && serialSource->isOpen()){
             qDebug()<<"Disconnecting. Error: "<<error;
             disconnectSerialPort(true, true);
         }
     });
 
-    //initialize the main soundboard widget
-    sbWidget = new SoundboardWidget(this);
+#ifdef Q_OS_LINUX
+    //global hotkeys from keyboards and macro pads, focused or not
+    keySource = new EvdevSource(triggers, this);
+    keySource->setKeys(triggerKeys);
+#endif
+#ifdef HAVE_ALSA
+    //pads and keys of MIDI controllers, as loud as they were hit
+    midiSource = new MidiSource(triggers, this);
+    midiSource->setBaseNote(midiBaseNote);
+#endif
 
-    //initialize and define the mediaplayers for device 1
-    for(int i=0; i<10; i++){
-        device1MediaPlayers.push_back(new QMediaPlayer(this));
-        connect(device1MediaPlayers[i], &QMediaPlayer::mediaStatusChanged, this, [this, i](QMediaPlayer::MediaStatus status) {
-            if (status == QMediaPlayer::EndOfMedia) {
-                soundEnd(i);
-            }
-        });
-    }
+    //the led under each slot until a device reports its own
+    setLedTable(DEFAULT_SLOT_LEDS);
 
-    //initialize and define the mediaplayers for device 2
-    for(int i=0; i<10; i++){
-        device2MediaPlayers.push_back(new QMediaPlayer(this));
-        connect(device2MediaPlayers[i], &QMediaPlayer::mediaStatusChanged, this, [this, i](QMediaPlayer::MediaStatus status) {
-            if (status == QMediaPlayer::EndOfMedia) {
-                soundEnd(i);
-            }
-        });
-    }
+    //the board starts out as the original ten-button one
+    setSlotCount(DEFAULT_SLOT_COUNT);
+
+    //the serial connection starts out closed
+    connectionStatusIcon_NONE = new QIcon(QApplication::style()->standardIcon(QStyle::SP_MessageBoxWarning));
+    connectionStatusIcon_ERR_ = new QIcon(QApplication::style()->standardIcon(QStyle::SP_MessageBoxCritical));
+    connectionStatusIcon_TRUE = new QIcon (":/icons/connected.png");
+    connectionIcon = connectionStatusIcon_NONE;
+    connectionToolTip = tr("Not Connected.");
+
+    //the widgets are destroyed once the window has sat in the tray for a while
+    //(see teardownInterface) and built again when it is shown. starting in the
+    //tray, they aren't built until then
+    teardownTimer = new QTimer(this);
+    teardownTimer->setSingleShot(true);
+    teardownTimer->setInterval(TRAY_TEARDOWN_DELAY_MS);
+    connect(teardownTimer, &QTimer::timeout, this, &Soundboard::teardownInterface);
+    if (!startMinimized) buildInterface();
+
+    StartupProfile::end("window");
+}
 
+//builds the window's widgets. everything they show is kept in Soundboard
+//itself, so this can run again whenever the window comes back from the tray
+void Soundboard::buildInterface() {
     //the main vertical layout for the app
     QVBoxLayout *mainLayout = new QVBoxLayout;
     QWidget *widget = new QWidget(this);
@@ -91,16 +184,13 @@ Soundboard::Soundboard(QWidget *parent)
     QHBoxLayout *portLayout = new QHBoxLayout;
     portComboBox = new QComboBox(this);
     portComboBox->setMinimumWidth(180);
-    refreshSerialPorts();
     portLayout->addWidget(portComboBox);
+    connect(portComboBox, &QComboBox::currentIndexChanged, this, [this](){
+        selectedPort = portComboBox->currentData().toString();
+    });
 
-    //set initial connection status
-    connectionStatusIcon_NONE = new QIcon(QApplication::style()->standardIcon(QStyle::SP_MessageBoxWarning));
-    connectionStatusIcon_ERR_ = new QIcon(QApplication::style()->standardIcon(QStyle::SP_MessageBoxCritical));
-    connectionStatusIcon_TRUE = new QIcon (":/icons/connected.png");
+    //show the connection status
     connectionStatusIconWrapper = new QLabel();
-    connectionStatusIconWrapper->setPixmap(connectionStatusIcon_NONE->pixmap(16,16));
-    connectionStatusIconWrapper->setToolTip("Not Connected.");
     portLayout->addWidget(connectionStatusIconWrapper);
 
     //define + initialize + connect the refresh/connect/disconnect buttons
@@ -119,7 +209,27 @@ Soundboard::Soundboard(QWidget *parent)
     });
     mainLayout->addLayout(portLayout);
 
+    //bank selection: each bank is another page of sounds for the same buttons
+    QHBoxLayout *bankLayout = new QHBoxLayout;
+    QPushButton *prevBankButton = new QPushButton(tr("Previous Bank"), this);
+    bankLabel = new QLabel(this);
+    bankLabel->setAlignment(Qt::AlignCenter);
+    QPushButton *nextBankButton = new QPushButton(tr("Next Bank"), this);
+    QPushButton *addBankButton = new QPushButton(tr("Add Bank"), this);
+    QPushButton *removeBankButton = new QPushButton(tr("Remove Bank"), this);
+    bankLayout->addWidget(prevBankButton);
+    bankLayout->addWidget(bankLabel);
+    bankLayout->addWidget(nextBankButton);
+    bankLayout->addWidget(addBankButton);
+    bankLayout->addWidget(removeBankButton);
+    connect(prevBankButton, &QPushButton::clicked, this, [this](){ switchBank(currentBank - 1); });
+    connect(nextBankButton, &QPushButton::clicked, this, [this](){ switchBank(currentBank + 1); });
+    connect(addBankButton, &QPushButton::clicked, this, &Soundboard::addBank);
+    connect(removeBankButton, &QPushButton::clicked, this, &Soundboard::removeBank);
+    mainLayout->addLayout(bankLayout);
+
     //add the soundboard ui widget
+    sbWidget = new SoundboardWidget(this);
     mainLayout->addWidget(sbWidget);
 
     //connections for the soundboard ui widget
@@ -127,7 +237,7 @@ Soundboard::Soundboard(QWidget *parent)
     connect(sbWidget, &SoundboardWidget::buttonRightClicked, this, &Soundboard::selectSound);
     connect(sbWidget, &SoundboardWidget::buttonPressed,      this, &Soundboard::playSound);
 
-    QHBoxLayout *helpLayout = new QHBoxLayout(this);
+    QHBoxLayout *helpLayout = new QHBoxLayout;
 
     //device selection and volume sliders
     //output device 1 selection
@@ -138,7 +248,7 @@ Soundboard::Soundboard(QWidget *parent)
 
     //output device help label
     outputHelpLabel = new QLabel(tr("<i><u>Why are there two outputs? (hover)</u></i>"), this);
-    outputHelpLabel->setToolTip("Sounds will be sent to both output devices simultaneously, but why?\nOne output is intended to be routed to your audio mixer application (Like Voicemeeter), to be mixed into your microphone.\nThis allows your friends to hear any triggered sounds when in a voice call.\nThe second output is intended to attach to your headphones, so you can hear the sound effect at the same time as your friends.\nI use a virtual audio cable (VB-AUDIO) with my headphone device configured to \"listen\" to the OUTPUT of the cable,\nand the INPUT of that same cable selected as one of the below outputs.");
+    outputHelpLabel->setToolTip("Sounds will be sent to both output devices simultaneously, but why?\nOne output is intended to be routed to your voice chat, usually through a virtual audio cable (like VB-AUDIO).\nThis allows your friends to hear any triggered sounds when in a voice call.\nThe second output is intended to attach to your headphones, so you can hear the sound effect at the same time as your friends.\nTick \"Mix Microphone Into Output One\" to have this program mix your microphone into Output One itself,\nthen select the OUTPUT of the cable as the microphone in your voice chat. No external mixer (like Voicemeeter) is needed.");
     helpLayout->addWidget(outputHelpLabel);
 
     mainLayout->addLayout(helpLayout);
@@ -151,8 +261,6 @@ Soundboard::Soundboard(QWidget *parent)
     mainLayout->addWidget(l2);
     mainLayout->addWidget(output2ComboBox);
 
-    populateAudioDevices();
-
     connect(output1ComboBox, &QComboBox::currentIndexChanged, this, &Soundboard::combo1Changed);
     connect(output2ComboBox, &QComboBox::currentIndexChanged, this, &Soundboard::combo2Changed);
 
@@ -192,46 +300,80 @@ Soundboard::Soundboard(QWidget *parent)
     connect(resetOutput1VolumeButton, &QPushButton::clicked, this, &Soundboard::resetOutput1Volume);
     connect(resetOutput2VolumeButton, &QPushButton::clicked, this, &Soundboard::resetOutput2Volume);
 
+    //microphone passthrough (the mic bus): the selected input is mixed with the sounds into output 1
+    micBusCheckBox = new QCheckBox(tr("Mix Microphone Into Output One"), this);
+    micBusCheckBox->setToolTip("Your microphone and the sound effects are mixed together and sent to Output One.\nSelect a virtual audio cable as Output One and use the cable as your microphone in voice chat.");
+    mainLayout->addWidget(micBusCheckBox);
+
+    //input device selection
+    inputComboBox = new QComboBox(this);
+    mainLayout->addWidget(inputComboBox);
+
+    //add Input Gain Slider
+    QHBoxLayout *inputGainLayout = new QHBoxLayout();
+    QLabel *inputGainLabel = new QLabel(tr("Microphone Gain"), this);
+    inputGainSlider = new QSlider(Qt::Horizontal, this);
+    inputGainSlider->setMinimum(0);
+    inputGainSlider->setMaximum(200);
+    inputGainValueLabel = new QLabel(QString("%1 %").arg(inputGain), this);
+    QPushButton *resetInputGainButton = new QPushButton(tr("Reset"), this);
+    inputGainLayout->addWidget(inputGainLabel);
+    inputGainLayout->addWidget(inputGainSlider);
+    inputGainLayout->addWidget(inputGainValueLabel);
+    inputGainLayout->addWidget(resetInputGainButton);
+    mainLayout->addLayout(inputGainLayout);
+
+    //microphone ducking: turn the microphone down while sounds are playing
+    QHBoxLayout *duckLayout = new QHBoxLayout();
+    duckingCheckBox = new QCheckBox(tr("Duck Microphone While Sounds Play"), this);
+    duckingCheckBox->setToolTip("Lowers your microphone in Output One while any sound is playing, then smoothly brings it back.");
+    duckAmountSlider = new QSlider(Qt::Horizontal, this);
+    duckAmountSlider->setMinimum(0);
+    duckAmountSlider->setMaximum(40);
+    duckAmountSlider->setToolTip("How far the microphone is turned down");
+    duckAmountValueLabel = new QLabel(QString("-%1 dB").arg(duckAmount), this);
+    duckLayout->addWidget(duckingCheckBox);
+    duckLayout->addWidget(duckAmountSlider);
+    duckLayout->addWidget(duckAmountValueLabel);
+    mainLayout->addLayout(duckLayout);
+
+    connect(duckingCheckBox, &QCheckBox::toggled, this, &Soundboard::duckingToggled);
+    connect(duckAmountSlider, &QSlider::valueChanged, this, &Soundboard::updateDuckAmountLabel);
+    connect(micBusCheckBox, &QCheckBox::toggled, this, &Soundboard::micBusToggled);
+    connect(inputComboBox, &QComboBox::currentIndexChanged, this, &Soundboard::inputComboChanged);
+    connect(inputGainSlider, &QSlider::valueChanged, this, &Soundboard::updateInputGainLabel);
+    connect(resetInputGainButton, &QPushButton::clicked, this, &Soundboard::resetInputGain);
+
     //setup the menu bar
     QMenu *userConfigMenu = menuBar()->addMenu(tr("User Config"));
-    QAction *loadConfigAction = new QAction(tr("Load Config"), this);
-    QAction *saveConfigAction = new QAction(tr("Save Config"), this);
+    QAction *loadConfigAction = new QAction(tr("Load Config"), userConfigMenu);
+    QAction *saveConfigAction = new QAction(tr("Save Config"), userConfigMenu);
+    QAction *routingAction = new QAction(tr("Sound Routing"), userConfigMenu);
     userConfigMenu->addAction(loadConfigAction);
     userConfigMenu->addAction(saveConfigAction);
+    userConfigMenu->addAction(routingAction);
 
     QMenu *initConfigMenu = menuBar()->addMenu(tr("Startup"));
-    QAction *toggleQuitSaveConfigAction = new QAction(tr("Save Config on Program Exit"), this);
+    QAction *toggleQuitSaveConfigAction = new QAction(tr("Save Config Automatically"), initConfigMenu);
+    toggleQuitSaveConfigAction->setToolTip(tr("Changes are written to the loaded config a moment after they are made, and on exit"));
     toggleQuitSaveConfigAction->setCheckable(true);
     initConfigMenu->addAction(toggleQuitSaveConfigAction);
-    QAction *toggleStartMinimizedAction = new QAction(tr("Start Progam Minimized"), this);
+    QAction *toggleStartMinimizedAction = new QAction(tr("Start Progam Minimized"), initConfigMenu);
     toggleStartMinimizedAction->setCheckable(true);
     initConfigMenu->addAction(toggleStartMinimizedAction);
     startupConfigMenu = initConfigMenu->addMenu(tr("Set Startup Config"));
-    QAction *helpStartupAction = new QAction(tr("Start Program on Login"), this);
+    QAction *helpStartupAction = new QAction(tr("Start Program on Login"), initConfigMenu);
     helpStartupAction->setIcon(QIcon(":/icons/info.ico"));
     helpStartupAction->setToolTip("Opens instructions on how to add this program to your startup folder.");
     initConfigMenu->addAction(helpStartupAction);
     initConfigMenu->setToolTipsVisible(true);
 
-    //add the option to not load any config at startup
-    QAction *noStartupConfigAction = new QAction(tr("None"), this);
-    startupConfigMenu->setToolTipsVisible(true);
-    noStartupConfigAction->setCheckable(true);
-    noStartupConfigAction->setChecked(cfgToLoadAtStartup == "NONE");
-    noStartupConfigAction->setToolTip(tr("Manually load a configuration file first to see it in this list!"));
-    startupConfigMenu->addAction(noStartupConfigAction);
-    connect(noStartupConfigAction, &QAction::triggered, this, [this](){
-        startupConfigSelected("NONE");
-    });
-
-    //update the known configs
-    updateKnownConfigsMenu();
-
     connect(loadConfigAction, &QAction::triggered, this, [this](){
         loadConfig(false);
     });
     connect(saveConfigAction, &QAction::triggered, this, &Soundboard::saveConfig);
     connect(helpStartupAction, &QAction::triggered, this, &Soundboard::openStartupHelp);
+    connect(routingAction, &QAction::triggered, this, &Soundboard::openRouting);
 
     //check if the program is currently set to start at boot and update the action
     toggleQuitSaveConfigAction->setChecked(saveCfgAtShutdown);
@@ -239,23 +381,171 @@ Soundboard::Soundboard(QWidget *parent)
 
     connect(toggleQuitSaveConfigAction, &QAction::triggered, this, [this](bool checked){
         saveCfgAtShutdown = checked;
+        if(checked && configDirty && loadedConfig != "") autosaveTimer->start();
     });
     connect(toggleStartMinimizedAction, &QAction::triggered, this, [this](bool checked){
         startMinimized = checked;
     });
 
+    //fill everything in from the current settings
+    syncInterface();
+}
+
+//shows the current settings in the widgets. they are filled with their
+//signals blocked, since showing a setting isn't changing it
+void Soundboard::syncInterface() {
+    if (!sbWidget) return;
+    const QSignalBlocker blockPorts(portComboBox), block1(output1ComboBox), block2(output2ComboBox), blockInput(inputComboBox);
+    const QSignalBlocker blockVolume1(output1VolumeSlider), blockVolume2(output2VolumeSlider), blockGain(inputGainSlider), blockDuck(duckAmountSlider);
+    const QSignalBlocker blockMic(micBusCheckBox), blockDucking(duckingCheckBox);
+
+    //the board
+    sbWidget->setSlotCount(soundFiles.size());
+    for (int i = 0; i < soundFiles.size(); ++i) sbWidget->setTableElement(i, soundFiles[i]);
+    updateBankLabel();
+
+    //the serial ports and the connection
+    portComboBox->clear();
+    for (const QSerialPortInfo &info : std::as_const(serialPorts)) {
+        portComboBox->addItem(info.portName() + " (" + info.manufacturer() + ")", info.systemLocation());
+    }
+    portComboBox->setCurrentIndex(portComboBox->findData(selectedPort));
+    if (!serialPortsListed) portComboBox->setToolTip("Looking for serial devices...");
+    else if (portComboBox->count() == 0) portComboBox->setToolTip("Connect a serial device, then hit refresh.");
+    else portComboBox->setToolTip("");
+    connectionStatusIconWrapper->setPixmap(connectionIcon->pixmap(16,16));
+    connectionStatusIconWrapper->setToolTip(connectionToolTip);
+
+    //the devices
+    output1ComboBox->clear();
+    output2ComboBox->clear();
+    inputComboBox->clear();
+    for (const auto &device : std::as_const(outputDevices)) {
+        QVariant variant = QVariant::fromValue(device);
+        output1ComboBox->addItem(device.description(), variant);
+        output2ComboBox->addItem(device.description(), variant);
+    }
+    for (const auto &device : std::as_const(inputDevices)) {
+        inputComboBox->addItem(device.description(), QVariant::fromValue(device));
+    }
+    output1ComboBox->setCurrentIndex(output1Index);
+    output2ComboBox->setCurrentIndex(output2Index);
+    inputComboBox->setCurrentIndex(inputIndex);
+
+    //the levels and the microphone
+    output1VolumeSlider->setValue(output1Volume);
+    output1VolumeValueLabel->setText(QString("%1 %").arg(output1Volume));
+    output2VolumeSlider->setValue(output2Volume);
+    output2VolumeValueLabel->setText(QString("%1 %").arg(output2Volume));
+    inputGainSlider->setValue(inputGain);
+    inputGainValueLabel->setText(QString("%1 %").arg(inputGain));
+    duckAmountSlider->setValue(duckAmount);
+    duckAmountValueLabel->setText(QString("-%1 dB").arg(duckAmount));
+    micBusCheckBox->setChecked(micBusEnabled);
+    duckingCheckBox->setChecked(duckingEnabled);
+    inputComboBox->setEnabled(micBusEnabled);
+    inputGainSlider->setEnabled(micBusEnabled);
+    duckingCheckBox->setEnabled(micBusEnabled);
+    duckAmountSlider->setEnabled(micBusEnabled);
+
+    updateKnownConfigsMenu();
+}
+
+//destroys the widgets once the window has sat in the tray for a while. the
+//device, the engine and the settings don't depend on them, so sounds keep
+//playing from the buttons and showFromTray() builds the window again
+void Soundboard::teardownInterface() {
+    if (isVisible() || !sbWidget) return;
+    //a dialog still open on top of the window would come back to no widgets
+    if (QApplication::activeModalWidget()) {
+        teardownTimer->start();
+        return;
+    }
+    delete takeCentralWidget();
+    setMenuWidget(nullptr);
+    setStatusBar(nullptr);
+    sbWidget = nullptr;
+    portComboBox = nullptr;
+    connectionStatusIconWrapper = nullptr;
+    bankLabel = nullptr;
+    output1ComboBox = output2ComboBox = inputComboBox = nullptr;
+    output1VolumeSlider = output2VolumeSlider = inputGainSlider = duckAmountSlider = nullptr;
+    output1VolumeValueLabel = output2VolumeValueLabel = inputGainValueLabel = duckAmountValueLabel = outputHelpLabel = nullptr;
+    micBusCheckBox = duckingCheckBox = nullptr;
+    startupConfigMenu = nullptr;
+    qDebug() << "Window widgets released while in the tray";
+}
+
+//brings up everything the window doesn't need to appear. the audio engine and
+//the list of serial ports are prepared on worker threads while the audio
+//devices are listed here; the startup config follows once the ports are in
+void Soundboard::startSubsystems() {
+    //PortAudio enumerates every host API and device as it starts
+    QThreadPool::globalInstance()->start([this](){
+        StartupProfile::begin("audio engine");
+        audio->initialize();
+        StartupProfile::end("audio engine");
+    });
+
+    StartupProfile::begin("serial ports");
+    QThreadPool::globalInstance()->start([this](){
+        const QList<QSerialPortInfo> ports = QSerialPortInfo::availablePorts();
+        QMetaObject::invokeMethod(this, [this, ports](){
+            listSerialPorts(ports);
+            StartupProfile::end("serial ports");
+            finishStartup();
+        }, Qt::QueuedConnection);
+    });
+
+    StartupProfile::begin("audio devices");
+    populateAudioDevices();
+    StartupProfile::end("audio devices");
+
+    //other programs, keys and MIDI controllers can trigger sounds from here on
+    control->listen(CONTROL_SERVER_NAME);
+#ifdef Q_OS_LINUX
+    keySource->start();
+#endif
+#ifdef HAVE_ALSA
+    midiSource->start();
+#endif
+}
+
+//loads the startup config and opens the output streams. the sounds keep
+//loading in the background; startup is done once they are in (importFinished)
+void Soundboard::finishStartup() {
+    StartupProfile::begin("config load");
+    StartupProfile::begin("sample cache warm");
     //self-explanatory
     if (loadCfgAtStartup)
         loadConfig(true);
 
-    device1AudioOutput = new QAudioOutput(outputDevice1, this);
-    device2AudioOutput = new QAudioOutput(outputDevice1, this);
+    syncInterface();
 
-    output1VolumeSlider->setValue(output1Volume);
-    output2VolumeSlider->setValue(output2Volume);
+    StartupProfile::end("config load");
+
+    //open the output streams (waits for the audio engine if it is still starting)
+    StartupProfile::begin("audio start");
+    restartAudio();
+    StartupProfile::end("audio start");
+
+    if (!importer->isBusy()) {
+        StartupProfile::end("sample cache warm");
+        StartupProfile::ready();
+    }
 }
 
 Soundboard::~Soundboard() {
+    //the startup tasks, the control server and the trigger sources use the engine
+    QThreadPool::globalInstance()->waitForDone();
+    delete control;
+    delete serialSource;
+#ifdef Q_OS_LINUX
+    delete keySource;
+#endif
+#ifdef HAVE_ALSA
+    delete midiSource;
+#endif
 }
 
 //detect window minimize event
@@ -264,6 +554,7 @@ void Soundboard::changeEvent(QEvent *event) {
         if (isMinimized()) {
             saveInitData();
             hide();  //hide window if minimized
+            teardownTimer->start(); //and let go of its widgets if it stays there
         }
     }
     QMainWindow::changeEvent(event); //call the super method
@@ -271,6 +562,8 @@ void Soundboard::changeEvent(QEvent *event) {
 
 //show the window from tray
 void Soundboard::showFromTray() {
+    teardownTimer->stop();
+    if (!sbWidget) buildInterface();
     showNormal();
     activateWindow();
 }
@@ -284,13 +577,11 @@ void Soundboard::publicAppExitPoint(){
 void Soundboard::exitApp() {
     saveInitData();
     trayIcon->hide();//hide the tray icon
-    if(saveCfgAtShutdown){
-        if(configChanged()){
-            QMessageBox::StandardButton choice = QMessageBox::information(this, tr("Question"), tr("Overwrite config?"), QMessageBox::Yes | QMessageBox::No);
-            if(choice == QMessageBox::Yes){
-                saveConfig(true);
-            }
-        }
+    if(saveCfgAtShutdown && configChanged()){
+        //changes to a loaded config are saved as they are made, so at most the
+        //last few seconds are left to write; a new config still needs a name
+        if(loadedConfig != "") writeConfig(loadedConfig);
+        else if(QMessageBox::information(this, tr("Question"), tr("Save config?"), QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes) saveConfig(true);
     }
     QApplication::quit();//call the super method
 }
@@ -303,85 +594,79 @@ void Soundboard::closeEvent(QCloseEvent *event) {
 
 //updates the serial port combo box with current serial ports
 void Soundboard::refreshSerialPorts() {
-    //clear any existing entries
-    portComboBox->clear();
-    foreach (const QSerialPortInfo &info, QSerialPortInfo::availablePorts()) {
-        portComboBox->addItem(info.portName() + " (" + info.manufacturer() + ")", info.systemLocation());
-    }
-    if(portComboBox->count() == 0)
-        portComboBox->setToolTip("Connect a serial device, then hit refresh.");
-    else portComboBox->setToolTip("");
+    listSerialPorts(QSerialPortInfo::availablePorts());
+}
+
+//takes in the list of serial ports; the selected one stays selected while it
+//is still there, otherwise the first one is
+void Soundboard::listSerialPorts(const QList<QSerialPortInfo> &ports) {
+    serialPorts = ports;
+    serialPortsListed = true;
+    bool present = false;
+    for (const QSerialPortInfo &info : ports) present = present || info.systemLocation() == selectedPort;
+    if (!present) selectedPort = ports.isEmpty() ? QString() : ports.first().systemLocation();
+    syncInterface();
 }
 
 //connect to the serial port selected in the combo box
 void Soundboard::connectToSerialPort(bool popup) {
     //close the serial port if it is already open
-    if (serial->isOpen()) {
-        serial->close();
+    if (serialSource->isOpen()) {
+        serialSource->close();
     }
 
-    //grab the selected serial port
-    QString selectedPort = portComboBox->currentData().toString();
-
     //check if a serial port is connected
     if (!selectedPort.isEmpty()) {
-        //set information about the port
-        serial->setPortName(selectedPort);
-        serial->setBaudRate(currentBaudRate);
-        serial->setDataBits(QSerialPort::Data8);
-        serial->setParity(QSerialPort::NoParity);
-        serial->setStopBits(QSerialPort::OneStop);
-        serial->setFlowControl(QSerialPort::NoFlowControl);
-        if(serial->isOpen())serial->setDataTerminalReady(true); //prevent arduino resets
-        if(serial->isOpen())serial->setRequestToSend(true);
-
-        //attempt to open the serial port
-        if (serial->open(QIODevice::ReadWrite)){
-            if(serial->isOpen())serial->setDataTerminalReady(true); //prevent arduino resets
-            if(serial->isOpen())serial->setRequestToSend(true);
+        //attempt to open the serial port (on the source's thread, which also
+        //asks the device how many buttons it has and which led sits under each)
+        if (serialSource->open(selectedPort, currentBaudRate, &serialError)){
             //if no errors occured, then connection was successful. update the status icon and tooltip
             if(serialError == QSerialPort::SerialPortError::NoError){
-                connectionStatusIconWrapper->setPixmap(connectionStatusIcon_TRUE->pixmap(16,16));
-                connectionStatusIconWrapper->setToolTip(tr("Connected to %1 at baud rate %2.").arg(selectedPort).arg(currentBaudRate));
+                markConfigDirty("serialPort");
+                setConnectionStatus(connectionStatusIcon_TRUE, tr("Connected to %1 at baud rate %2.").arg(selectedPort).arg(currentBaudRate));
                 if(popup)QMessageBox::information(this, tr("Connected"), tr("Successfully connected to %1 at baud rate %2").arg(selectedPort).arg(currentBaudRate));
                 return;
             }
             else{
-                connectionStatusIconWrapper->setPixmap(connectionStatusIcon_ERR_->pixmap(16,16));
-                connectionStatusIconWrapper->setToolTip(tr("Disconnected. Error: %1").arg(toString(serialError)));
+                setConnectionStatus(connectionStatusIcon_ERR_, tr("Disconnected. Error: %1").arg(toString(serialError)));
                 QMessageBox::critical(this, tr("Error"), tr("Unable to connect to serial port.\nError: %1").arg(toString(serialError)));
             }
         }
         else{
             //the serial port wasn't able to be opened
-            connectionStatusIconWrapper->setPixmap(connectionStatusIcon_ERR_->pixmap(16,16));
-            connectionStatusIconWrapper->setToolTip(tr("Failed to open serial port %1 with baud rate %2.").arg(selectedPort).arg(currentBaudRate));
+            setConnectionStatus(connectionStatusIcon_ERR_, tr("Failed to open serial port %1 with baud rate %2.").arg(selectedPort).arg(currentBaudRate));
             QMessageBox::critical(this, tr("Error"), tr("Failed to open serial port %1 with baud rate %2.").arg(selectedPort).arg(currentBaudRate));
             return;
         }
     }
     else {
         //no port was selected in the combo box
-        connectionStatusIconWrapper->setPixmap(connectionStatusIcon_NONE->pixmap(16,16));
-        connectionStatusIconWrapper->setToolTip(tr("Not Connected."));
+        setConnectionStatus(connectionStatusIcon_NONE, tr("Not Connected."));
         QMessageBox::critical(this, tr("Error"), tr("Please select a port."));
     }
 
 }
 
+//shows the state of the serial connection next to the port list
+void Soundboard::setConnectionStatus(QIcon *icon, const QString &toolTip) {
+    connectionIcon = icon;
+    connectionToolTip = toolTip;
+    if (!connectionStatusIconWrapper) return;
+    connectionStatusIconWrapper->setPixmap(icon->pixmap(16,16));
+    connectionStatusIconWrapper->setToolTip(toolTip);
+}
+
 //disconnect from the current serial port, if there is a connection
 void Soundboard::disconnectSerialPort(bool error, bool popup){
     //if the serial port is already closed, punch the user in the face
-    if(!serial->isOpen()){
-        connectionStatusIconWrapper->setPixmap(connectionStatusIcon_NONE->pixmap(16,16));
-        connectionStatusIconWrapper->setToolTip(tr("Not connected."));
+    if(!serialSource->isOpen()){
+        setConnectionStatus(connectionStatusIcon_NONE, tr("Not connected."));
         QMessageBox::critical(this, tr("Error"), tr("Not connected to a serial port."));
         return;
     }
     if(error && popup){
-        if(serial->isOpen())serial->close();
-        connectionStatusIconWrapper->setPixmap(connectionStatusIcon_ERR_->pixmap(16,16));
-        connectionStatusIconWrapper->setToolTip(tr("Disconnected from serial port."));
+        if(serialSource->isOpen())serialSource->close();
+        setConnectionStatus(connectionStatusIcon_ERR_, tr("Disconnected from serial port."));
         QMessageBox::Button choice = QMessageBox::critical(this, tr("Error"), tr("Disconnected from serial port.\nError: %1").arg(toString(serialError)), QMessageBox::Ok | QMessageBox::Retry);
         if(choice == QMessageBox::Retry){
             //retry the serial port connection
@@ -389,251 +674,73 @@ void Soundboard::disconnectSerialPort(bool error, bool popup){
         }
     }
     else if(!error && popup){
-        if(serial->isOpen())serial->close();
-        connectionStatusIconWrapper->setPixmap(connectionStatusIcon_NONE->pixmap(16,16));
-        connectionStatusIconWrapper->setToolTip(tr("Not connected."));
+        if(serialSource->isOpen())serialSource->close();
+        setConnectionStatus(connectionStatusIcon_NONE, tr("Not connected."));
         QMessageBox::information(this, tr("Notice"), tr("Disconnected from serial port."));
     }
     else {
-        if(serial->isOpen())serial->close();
-        connectionStatusIconWrapper->setPixmap(connectionStatusIcon_NONE->pixmap(16,16));
-        connectionStatusIconWrapper->setToolTip(tr("Not connected."));
+        if(serialSource->isOpen())serialSource->close();
+        setConnectionStatus(connectionStatusIcon_NONE, tr("Not connected."));
     }
 }
 
 //prompt the user for a sound file
 void Soundboard::selectSound(int index) {
-    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Audio File"), "", tr("Audio Files (*.wav *.mp3)"));
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Audio File"), "", tr("Audio Files (*.wav *.mp3 *.flac *.ogg)"));
     if (QFile(fileName).exists()) {
         soundFiles[index] = fileName;
-        sbWidget->setTableElement(index, fileName);
+        showSound(index);
     }
     else{
         QMessageBox::critical(this, tr("Error: BadSoundError"), tr("File \"%1\" does not exist.").arg(fileName));
         soundFiles[index] = "";
-        sbWidget->setTableElement(index, "");
+        showSound(index);
     }
+    slotTrims[index] = {-1, -1}; //a new sound gets its own start and end points
+    markConfigDirty("sounds");
+    loadSound(index);
 }
 
 //a file was dropped on a button
 void Soundboard::fileDropped(int index, const QString& fileName){
     if (QFile(fileName).exists()) {
         soundFiles[index] = fileName;
-        sbWidget->setTableElement(index, fileName);
+        showSound(index);
     }
     else{
         QMessageBox::critical(this, tr("Error: BadSoundError"), tr("File \"%1\" does not exist.").arg(fileName));
         soundFiles[index] = "";
-        sbWidget->setTableElement(index, "");
+        showSound(index);
     }
+    slotTrims[index] = {-1, -1}; //a new sound gets its own start and end points
+    markConfigDirty("sounds");
+    loadSound(index);
 }
 
-//serial data was recieved (if a serial port is open)
-void Soundboard::receiveSerialData() {
-    while (serial->canReadLine()) {
-        //grab the serial data
-        QString data = QString(serial->readLine().trimmed());
-        for(int i=0;i<data.length(); i++){
-            if(data[i] == '1'){//if 1, the button is pressed down
-                if(oldSerialData[i] == '1' && s1[i] == '1' && s2[i] == '0'){//if the previous data for this index was 0, then this button was *JUST* pressed
-                    // qDebug()<<oldSerialData<<" old:new "<<data<<" Playing sound!";
-                    playSound((i+1)/2);//play the sound
-                }
-            }
-        }
-        //update the old serial data
-        s2 = s1;
-        s1 = oldSerialData;
-        oldSerialData = data;
-        // qDebug()<<"Recieved: "+data.toStdString();
-    }
+//play a sound
+void Soundboard::playSound(int index) {
+    if (index < 0 || index >= soundFiles.size()) return;
+
+    //play the sound on every output first, the led can wait
+    if (!soundFiles[index].isEmpty()) audio->play(index);
+    soundTriggered(index);
 }
 
-//send serial data to the device (if a serial port is open)
-void Soundboard::sendSerialData(const QString &data) {
-    if (serial->isOpen() && serial->isWritable()) {
-        serial->write(data.toUtf8());
-        // qDebug()<<"Sent: "+data.toUtf8();
-    }
+//the presses the trigger sources have played since this was last called
+void Soundboard::handleTriggers() {
+    for (const TriggerEvent &event : triggers->take()) soundTriggered(event.slot);
 }
 
-//play a sound
-void Soundboard::playSound(int index) {
+//a slot was triggered, and its sound (if it has one) is already playing
+void Soundboard::soundTriggered(int index) {
+    if (index < 0 || index >= soundFiles.size()) return;
+
     //check if a sound is loaded
     if (!soundFiles[index].isEmpty()) {
-        device1AudioOutput = new QAudioOutput(outputDevice1, this);
-        device1AudioOutput->setVolume(scale(output1Volume));
-        device2AudioOutput = new QAudioOutput(outputDevice2, this);
-        device2AudioOutput->setVolume(scale(output2Volume));
-
-        // qDebug()<<"outdev1: "<<outputDevice1.description();
-        // qDebug()<<"outdev2: "<<outputDevice2.description();
-
-        // qDebug()<<"outvol1: "<<scale(output1Volume);
-        // qDebug()<<"outvol2: "<<scale(output2Volume);
-
-        //play the sound and send the action to the device
-        //map the sound to the correct led (button → LED):
-        //1 → 10   3 → 9    5 → 8    7 → 7    9  → 6
-        //2 → 1    4 → 2    6 → 3    8 → 4    10 → 5
-        //then map the led to the correct string index for
-        //the serial communication protocol.
-        switch(index){
-        case 0:
-            //play into device 1
-            device1MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device1MediaPlayers[index]->setAudioOutput(device1AudioOutput);
-            device1MediaPlayers[index]->play();
-
-            //play into device 2
-            device2MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device2MediaPlayers[index]->setAudioOutput(device2AudioOutput);
-            device2MediaPlayers[index]->play();
-
-            //send serial data
-            serialData[18] = '1';
-            sendSerialData(serialData);
-            break;
-        case 1:
-            //play into device 1
-            device1MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device1MediaPlayers[index]->setAudioOutput(device1AudioOutput);
-            device1MediaPlayers[index]->play();
-
-            //play into device 2
-            device2MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device2MediaPlayers[index]->setAudioOutput(device2AudioOutput);
-            device2MediaPlayers[index]->play();
-
-            //send serial data
-            serialData[0] = '1';
-            sendSerialData(serialData);
-            break;
-        case 2:
-            //play into device 1
-            device1MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device1MediaPlayers[index]->setAudioOutput(device1AudioOutput);
-            device1MediaPlayers[index]->play();
-
-            //play into device 2
-            device2MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device2MediaPlayers[index]->setAudioOutput(device2AudioOutput);
-            device2MediaPlayers[index]->play();
-
-            //send serial data
-            serialData[16] = '1';
-            sendSerialData(serialData);
-            break;
-        case 3:
-            //play into device 1
-            device1MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device1MediaPlayers[index]->setAudioOutput(device1AudioOutput);
-            device1MediaPlayers[index]->play();
-
-            //play into device 2
-            device2MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device2MediaPlayers[index]->setAudioOutput(device2AudioOutput);
-            device2MediaPlayers[index]->play();
-
-            //send serial data
-            serialData[2] = '1';
-            sendSerialData(serialData);
-            break;
-        case 4:
-            //play into device 1
-            device1MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device1MediaPlayers[index]->setAudioOutput(device1AudioOutput);
-            device1MediaPlayers[index]->play();
-
-            //play into device 2
-            device2MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device2MediaPlayers[index]->setAudioOutput(device2AudioOutput);
-            device2MediaPlayers[index]->play();
-
-            //send serial data
-            serialData[14] = '1';
-            sendSerialData(serialData);
-            break;
-        case 5:
-            //play into device 1
-            device1MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device1MediaPlayers[index]->setAudioOutput(device1AudioOutput);
-            device1MediaPlayers[index]->play();
-
-            //play into device 2
-            device2MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device2MediaPlayers[index]->setAudioOutput(device2AudioOutput);
-            device2MediaPlayers[index]->play();
-
-            //send serial data
-            serialData[4] = '1';
-            sendSerialData(serialData);
-            break;
-        case 6:
-            //play into device 1
-            device1MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device1MediaPlayers[index]->setAudioOutput(device1AudioOutput);
-            device1MediaPlayers[index]->play();
-
-            //play into device 2
-            device2MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device2MediaPlayers[index]->setAudioOutput(device2AudioOutput);
-            device2MediaPlayers[index]->play();
-
-            //send serial data
-            serialData[12] = '1';
-            sendSerialData(serialData);
-            break;
-        case 7:
-            //play into device 1
-            device1MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device1MediaPlayers[index]->setAudioOutput(device1AudioOutput);
-            device1MediaPlayers[index]->play();
-
-            //play into device 2
-            device2MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device2MediaPlayers[index]->setAudioOutput(device2AudioOutput);
-            device2MediaPlayers[index]->play();
-
-            //send serial data
-            serialData[6] = '1';
-            sendSerialData(serialData);
-            break;
-        case 8:
-            //play into device 1
-            device1MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device1MediaPlayers[index]->setAudioOutput(device1AudioOutput);
-            device1MediaPlayers[index]->play();
-
-            //play into device 2
-            device2MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device2MediaPlayers[index]->setAudioOutput(device2AudioOutput);
-            device2MediaPlayers[index]->play();
-
-            //send serial data
-            serialData[10] = '1';
-            sendSerialData(serialData);
-            break;
-        case 9:
-            //play into device 1
-            device1MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device1MediaPlayers[index]->setAudioOutput(device1AudioOutput);
-            device1MediaPlayers[index]->play();
-
-            //play into device 2
-            device2MediaPlayers[index]->setSource(QUrl::fromLocalFile(soundFiles[index]));
-            device2MediaPlayers[index]->setAudioOutput(device2AudioOutput);
-            device2MediaPlayers[index]->play();
-
-            //send serial data
-            serialData[8] = '1';
-            sendSerialData(serialData);
-            break;
-        default:
-            //an invalid index was provided
-            QMessageBox::critical(this, tr("Error"), tr("Invalid index supplied: %1").arg(index));
-            return;
-        }
+        budget->notePress(index);
+
+        //light the slot's led on the device
+        setLed(index, true);
     }
     //if there is no sound selected for this index
     else{
@@ -673,94 +780,182 @@ void Soundboard::playSound(int index) {
 
 //triggered when a sound stops playing
 void Soundboard::soundEnd(int index) {
-    //send the action to the device after mapping
-    //the sound to the correct led (button → LED):
-    //1 → 10   3 → 9    5 → 8    7 → 7    9  → 6
-    //2 → 1    4 → 2    6 → 3    8 → 4    10 → 5
-    //then, map the led to the correct string index
-    //for the serial communication protocol.
-    switch(index){
-    case 0:
-        serialData[18] = '0';
-        sendSerialData(serialData);
-        break;
-    case 1:
-        serialData[0] = '0';
-        sendSerialData(serialData);
-        break;
-    case 2:
-        serialData[16] = '0';
-        sendSerialData(serialData);
-        break;
-    case 3:
-        serialData[2] = '0';
-        sendSerialData(serialData);
-        break;
-    case 4:
-        serialData[14] = '0';
-        sendSerialData(serialData);
-        break;
-    case 5:
-        serialData[4] = '0';
-        sendSerialData(serialData);
-        break;
-    case 6:
-        serialData[12] = '0';
-        sendSerialData(serialData);
-        break;
-    case 7:
-        serialData[6] = '0';
-        sendSerialData(serialData);
-        break;
-    case 8:
-        serialData[10] = '0';
-        sendSerialData(serialData);
-        break;
-    case 9:
-        serialData[8] = '0';
-        sendSerialData(serialData);
-        break;
-    default:
-        //an invalid index was provided
-        QMessageBox::critical(this, tr("Error"), tr("Invalid index supplied: %1").arg(index));
-        return;
+    //turn the slot's led back off on the device
+    setLed(index, false);
+}
+
+//sets the state of the led under a slot on the device
+void Soundboard::setLed(int slot, bool on) {
+    serialSource->setLed(slot, on);
+}
+
+//sets which led sits under each slot
+void Soundboard::setLedTable(const QList<int> &leds) {
+    serialSource->setLedTable(leds);
+}
+
+//grows the board to 'count' slots (never shrinks, so no assigned sound is dropped)
+void Soundboard::setSlotCount(int count) {
+    count = std::clamp(count, 1, MAX_SLOTS);
+    if (count <= soundFiles.size()) return;
+    soundFiles.resize(count);
+    slotRoutes.resize(count, QList<int>(NUM_BUSES, DEFAULT_LEVEL));
+    slotTrims.resize(count, QList<int>{-1, -1});
+    if (sbWidget) sbWidget->setSlotCount(count);
+
+    //slots the led table doesn't cover get leds of their own after the known ones
+    QList<int> leds = serialSource->ledTable();
+    int next = leds.isEmpty() ? 0 : *std::max_element(leds.begin(), leds.end()) + 1;
+    while (leds.size() < count) leds.append(next++);
+    if (leds != serialSource->ledTable()) setLedTable(leds);
+}
+
+//switches to another bank (wrapping around at either end)
+void Soundboard::switchBank(int bank) {
+    if (banks.size() < 2) return;
+    bank = (bank % banks.size() + banks.size()) % banks.size();
+    if (bank == currentBank) return;
+    storeActiveBank(true);
+    activateBank(bank);
+    markConfigDirty("currentBank");
+}
+
+//makes a bank the active one. the neighbours of the current bank are preloaded,
+//so switching to them hands the engine every slot at once (one lock, no decoding):
+//the next press already plays the new bank and voices still playing finish as they were
+void Soundboard::activateBank(int bank) {
+    Bank &target = banks[bank];
+    resizeBank(target);
+
+    QElapsedTimer timer;
+    timer.start();
+    QVector<AudioManager::SlotState> states(target.sounds.size());
+    QList<int> missing;
+    for (int i = 0; i < target.sounds.size(); ++i) {
+        if (target.sounds[i].isEmpty()) continue;
+        if (!target.samples[i]) {
+            //not preloaded (a bank further away, or still loading); it follows shortly
+            missing.append(i);
+            continue;
+        }
+        states[i].sample = target.samples[i];
+        if (target.trims[i][0] >= 0 && target.trims[i][1] >= 0) {
+            states[i].trimStart = qint64(target.trims[i][0]) * states[i].sample->sampleRate / 1000;
+            states[i].trimEnd = qint64(target.trims[i][1]) * states[i].sample->sampleRate / 1000;
+        }
+        states[i].gain = target.gains[i];
     }
+    audio->setSlots(states);
+    const qint64 switchNs = timer.nsecsElapsed();
+
+    currentBank = bank;
+    soundFiles = target.sounds;
+    slotTrims = target.trims;
+    target.samples.fill(nullptr); //the engine holds them now
+    for (int i = 0; i < soundFiles.size(); ++i) {
+        showSound(i);
+        budget->track(i, soundFiles[i]);
+    }
+    watcher->setFiles(soundFiles);
+    if (!missing.isEmpty()) loadSounds(missing);
+    qCDebug(lcTiming) << "Switched to bank" << bank + 1 << "in" << switchNs / 1000 << "us," << missing.size() << "sounds still loading";
+
+    updateBankLabel();
+    preloadBanks();
 }
 
-//save a configuration file
-void Soundboard::saveConfig(bool exit) {
-    //ask the user where to save the file
-    QString fileName = loadedConfig;
-    if((!exit || loadedConfig == "") || (exit && loadedConfig == "")) fileName = QFileDialog::getSaveFileName(this, tr("Save Config File"), "", tr("Config Files (*.json)"));
-    if (!fileName.isEmpty()) {
-        QJsonObject config;
-        QJsonArray soundArray;
+//copies the active bank back into its entry; when another bank takes over
+//it also keeps the loaded sounds, so switching back is instant as well
+void Soundboard::storeActiveBank(bool keepSamples) {
+    Bank &bank = banks[currentBank];
+    bank.sounds = soundFiles;
+    bank.trims = slotTrims;
+    if (!keepSamples) return;
+    bank.samples.resize(soundFiles.size());
+    bank.gains.resize(soundFiles.size());
+    for (int i = 0; i < soundFiles.size(); ++i) {
+        bank.samples[i] = audio->sample(i);
+        bank.gains[i] = audio->slotGain(i);
+    }
+}
 
-        //append all of the sounds
-        for (const QString &file : std::as_const(soundFiles)) {
-            soundArray.append(file);
+//loads the banks either side of the current one in the background and lets go
+//of the rest. they stream from the disk cache until they become active, so a
+//preloaded bank costs little more than the head of each sound
+void Soundboard::preloadBanks() {
+    const int previous = (currentBank + banks.size() - 1) % banks.size();
+    const int next = (currentBank + 1) % banks.size();
+    QList<ImportPipeline::Job> jobs;
+    for (int b = 0; b < banks.size(); ++b) {
+        if (b == currentBank) continue;
+        Bank &bank = banks[b];
+        resizeBank(bank);
+        if (b != previous && b != next) {
+            bank.samples.fill(nullptr);
+            continue;
         }
+        for (int i = 0; i < bank.sounds.size(); ++i) {
+            if (bank.sounds[i].isEmpty() || bank.samples[i]) continue;
+            ImportPipeline::Job job;
+            job.slot = i;
+            job.bank = b;
+            job.path = bank.sounds[i];
+            job.residency = SampleLoader::Residency::Streaming;
+            job.findTrim = bank.trims[i][0] < 0 || bank.trims[i][1] < 0;
+            job.silenceThresholdDb = silenceThresholdDb;
+            jobs.append(job);
+        }
+    }
+    importer->submit(jobs);
+}
 
-        config["GLOBAL_PROGRAM_VERSION"] = GLOBAL_PROGRAM_VERSION;
+//gives a bank an entry for every slot on the board (or for 'count' slots)
+void Soundboard::resizeBank(Bank &bank, int count) {
+    if (count < 0) count = soundFiles.size();
+    bank.sounds.resize(count);
+    bank.trims.resize(count, QList<int>{-1, -1});
+    bank.samples.resize(count);
+    bank.gains.resize(count, 1.0f);
+}
 
-        config["sounds"] = soundArray;
+//adds an empty bank after the current one and switches to it
+void Soundboard::addBank() {
+    storeActiveBank(true);
+    Bank bank;
+    resizeBank(bank);
+    banks.insert(currentBank + 1, bank);
+    activateBank(currentBank + 1);
+    markConfigDirty("banks");
+}
 
-        //add the serial port
-        config["serialPort"] = portComboBox->currentData().toString();
+//drops the current bank and shows the one after it
+void Soundboard::removeBank() {
+    if (banks.size() < 2) return;
+    if (QMessageBox::question(this, tr("Remove Bank"), tr("Remove bank %1 and its sounds?").arg(currentBank + 1)) != QMessageBox::Yes) return;
+    banks.removeAt(currentBank);
+    activateBank(std::min<int>(currentBank, banks.size() - 1));
+    markConfigDirty("banks");
+}
 
-        //add the device id's
-        config["outputDevice1Id"] = QString::fromUtf8(output1ComboBox->currentData().value<QAudioDevice>().id());
-        config["outputDevice2Id"] = QString::fromUtf8(output2ComboBox->currentData().value<QAudioDevice>().id());
+//shows the sound assigned to a slot in the table
+void Soundboard::showSound(int index) {
+    if (sbWidget) sbWidget->setTableElement(index, soundFiles[index]);
+}
 
-        //add the input and output volumes
-        config["output1Volume"] = output1Volume;
-        config["output2Volume"] = output2Volume;
+void Soundboard::updateBankLabel() {
+    if (!bankLabel) return;
+    bankLabel->setText(tr("Bank %1 / %2").arg(currentBank + 1).arg(banks.size()));
+}
 
-        //save the file
-        QFile file(fileName);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(QJsonDocument(config).toJson());
-            file.close();
+//save a configuration file
+void Soundboard::saveConfig(bool exit) {
+    //ask the user where to save the file
+    QString fileName = loadedConfig;
+    if((!exit || loadedConfig == "") || (exit && loadedConfig == "")) fileName = QFileDialog::getSaveFileName(this, tr("Save Config File"), "", tr("Config Files (*.json);;Binary Config Files (*.cbor)"));
+    if (!fileName.isEmpty()) {
+        if (writeConfig(fileName)) {
+            //the saved file is now the one changes are saved to
+            loadedConfig = fileName;
             if(!exit) QMessageBox::information(this, tr("Success"), tr("Configuration saved successfully"));
         } else {
             QMessageBox::critical(this, tr("Error"), tr("Failed to save configuration file"));
@@ -768,157 +963,411 @@ void Soundboard::saveConfig(bool exit) {
     }
 }
 
-//load a configuration file
+//writes the current settings to a configuration file. the file is written
+//next to the old one and renamed over it (see ConfigFile::write), so a crash
+//or a full disk leaves either the old file or the new one, never a truncated mix
+bool Soundboard::writeConfig(const QString &fileName) {
+    //keys this version doesn't know about are kept as they were read
+    QJsonObject config = savedConfig;
+    QJsonArray soundArray;
+
+    //append all of the sounds
+    for (const QString &file : std::as_const(soundFiles)) {
+        soundArray.append(file);
+    }
+
+    config["GLOBAL_PROGRAM_VERSION"] = GLOBAL_PROGRAM_VERSION;
+
+    config["sounds"] = soundArray;
+
+    //add the serial port
+    config["serialPort"] = selectedPort;
+
+    //add the device id's
+    config["outputDevice1Id"] = QString::fromUtf8(outputDevices.value(output1Index).id());
+    config["outputDevice2Id"] = QString::fromUtf8(outputDevices.value(output2Index).id());
+
+    //add the input and output volumes
+    config["output1Volume"] = output1Volume;
+    config["output2Volume"] = output2Volume;
+
+    //add the microphone passthrough settings
+    config["micBusEnabled"] = micBusEnabled;
+    config["inputDeviceId"] = QString::fromUtf8(inputDevices.value(inputIndex).id());
+    config["inputGain"] = inputGain;
+
+    //add the routing matrix (gain of each sound on each output)
+    QJsonArray routeArray;
+    for (const QList<int> &routes : std::as_const(slotRoutes)) {
+        QJsonArray row;
+        for (int gain : routes) row.append(gain);
+        routeArray.append(row);
+    }
+    config["routes"] = routeArray;
+
+    //add the start and end points of each sound (ms into the file) and the
+    //level below which leading and trailing audio counts as silence
+    QJsonArray trimArray;
+    for (const QList<int> &trim : std::as_const(slotTrims))
+        trimArray.append(QJsonArray{trim[0], trim[1]});
+    config["trims"] = trimArray;
+    config["silenceThresholdDb"] = silenceThresholdDb;
+
+    //add every bank (the active one included, which "sounds" and "trims" above
+    //repeat for older versions), the one showing and the buttons that switch them
+    storeActiveBank(false);
+    QJsonArray bankArray;
+    for (const Bank &bank : std::as_const(banks)) {
+        QJsonArray bankTrims;
+        for (const QList<int> &trim : bank.trims)
+            bankTrims.append(QJsonArray{trim[0], trim[1]});
+        bankArray.append(QJsonObject{{"sounds", QJsonArray::fromStringList(bank.sounds)}, {"trims", bankTrims}});
+    }
+    config["banks"] = bankArray;
+    config["currentBank"] = currentBank;
+    QJsonArray prevArray, nextArray;
+    for (int button : std::as_const(prevBankButtons)) prevArray.append(button + 1);
+    for (int button : std::as_const(nextBankButtons)) nextArray.append(button + 1);
+    config["prevBankButtons"] = prevArray;
+    config["nextBankButtons"] = nextArray;
+
+    //add the keys and the MIDI notes that trigger sounds
+    QJsonArray keyArray;
+    for (int key : std::as_const(triggerKeys)) keyArray.append(key);
+    config["triggerKeys"] = keyArray;
+    config["midiBaseNote"] = midiBaseNote;
+
+    //add the loudness normalization settings
+    config["normalizeLoudness"] = normalizeLoudness;
+    config["targetLufs"] = targetLufs;
+
+    //add the microphone ducking settings
+    config["duckingEnabled"] = duckingEnabled;
+    config["duckAmountDb"] = duckAmount;
+    config["duckAttackMs"] = duckAttackMs;
+    config["duckReleaseMs"] = duckReleaseMs;
+
+    //add the gain smoothing settings
+    config["gainRampMs"] = gainRampMs;
+    config["fadeMs"] = fadeMs;
+
+    //add the load-time resampling quality (0 = fast, 1 = balanced, 2 = best)
+    config["resampleQuality"] = resampleQuality;
+
+    //save the file, in binary if its name ends in .cbor
+    if (!ConfigFile::write(fileName, config)) return false;
+
+    qDebug() << "Saved" << fileName << "changed:" << configJournal;
+    savedConfig = config;
+    configDirty = false;
+    configJournal.clear();
+    autosaveTimer->stop();
+    return true;
+}
+
+//records a change to the configuration. when changes are saved automatically
+//the loaded file is written once the settings have been left alone for a moment
+void Soundboard::markConfigDirty(const QString &what) {
+    configDirty = true;
+    if (!configJournal.contains(what)) configJournal.append(what);
+    if (saveCfgAtShutdown && !loadedConfig.isEmpty()) autosaveTimer->start();
+}
+
+//load a configuration file. the current one keeps playing while the new
+//sounds decode in the background; see stageConfig() and applyConfig()
 void Soundboard::loadConfig(bool initial) {
     //ask the user which file to load
     QString fileName;
-    if(!initial)fileName = QFileDialog::getOpenFileName(this, tr("Open Config File"), "", tr("Config Files (*.json)"));
+    if(!initial)fileName = QFileDialog::getOpenFileName(this, tr("Open Config File"), "", tr("Config Files (*.json *.cbor)"));
     else fileName = cfgToLoadAtStartup;
     if (!fileName.isEmpty()) {
-        //create the file object
-        QFile file(fileName);
-        //attempt to read the file
-        if (file.open(QIODevice::ReadOnly)) {
-            //read the file as a json then close it
-            QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-            file.close();
-
-            //check if the file is formatted properly then load all of its data
-            if (doc.isObject()) {
-                QJsonObject config = doc.object();
-                //check the program version
-                if(config.contains("GLOBAL_PROGRAM_VERSION")){
-                    if(config["GLOBAL_PROGRAM_VERSION"] != GLOBAL_PROGRAM_VERSION){
-                        //outdated user config
-                        QMessageBox::critical(this, "Error: OutdatedConfigError", "The selected configuration file was created by a different version of this program and cannot be loaded.");
-                        return;
-                    }
-                }
-                else {
-                    if(config.contains("outputDevice1Index") && config.contains("outputDevice2Index")){//refactor the configuration file
-                        //add GLOBAL_PROGRAM_VERSION
-                        config["GLOBAL_PROGRAM_VERSION"] = GLOBAL_PROGRAM_VERSION;
-
-                        //change the device indices to id's
-                        output1ComboBox->setCurrentIndex(config["outputDevice1Index"].toInt());
-                        config["outputDevice1Id"] = QString::fromUtf8(output1ComboBox->currentData().value<QAudioDevice>().id());
-                        config.remove("outputDevice1Index");
-
-                        output2ComboBox->setCurrentIndex(config["outputDevice2Index"].toInt());
-                        config["outputDevice2Id"] = QString::fromUtf8(output2ComboBox->currentData().value<QAudioDevice>().id());
-                        config.remove("outputDevice2Index");
-
-                        //write the file
-                        file.open(QIODevice::WriteOnly);
-                        file.write(QJsonDocument(config).toJson());
-                        file.close();
-                    }
-                    else {
-                        QMessageBox::critical(this, "Error: Missing GLOBAL_PROGRAM_VERSION", "The selected configuration file is missing GLOBAL_PROGRAM_VERSION.");
-                        return;
-                    }
-                }
-
-                //load the sounds
-                if (config.contains("sounds") && config["sounds"].isArray()) {
-                    QJsonArray soundArray = config["sounds"].toArray();
-                    for (int i = 0; i < soundArray.size() && i < 10; ++i) {
-                        //verify that the file exists
-                        if(!QFile(soundArray[i].toString()).exists()){
-                            QMessageBox::critical(this, tr("Error: BadSoundError"), tr("File \"%1\" does not exist.").arg(soundArray[i].toString()));
-                            soundFiles[i] = "";
-                            sbWidget->setTableElement(i, "");
-                        }
-                        else{
-                            soundFiles[i] = soundArray[i].toString();
-                            sbWidget->setTableElement(i, soundArray[i].toString());
-                        }
-                    }
-                }
-                else {
-                    //alert user of incorrectly formatted configuration
-                    QMessageBox::critical(this, tr("Error: NoSoundsError"), tr("Failed to parse configuration file %1").arg(fileName));
-                    return;
-                }
-
-                //load the serial port
-                if (config.contains("serialPort")) {
-
-                    //refresh the serial ports
-                    refreshSerialPorts();
-
-                    QString savedPort = config["serialPort"].toString();
-                    if (portComboBox->findData(savedPort) != -1) {
-                        portComboBox->setCurrentIndex(portComboBox->findData(savedPort));
-                    }
-                    else qDebug()<<"Error loading serial port";
-                }
-                else {
-                    //alert user of incorrectly formatted configuration
-                    QMessageBox::critical(this, tr("Error: NoSerialError"), tr("Failed to parse configuration file %1").arg(fileName));
-                    return;
-                }
-
-                //load input and output device id
-                if(config.contains("outputDevice1Id") && config.contains("outputDevice2Id")){
-                    QByteArray outputDevice1Id = config["outputDevice1Id"].toString().toUtf8();
-                    output1Index = index(outputDevice1Id);
-                    output1ComboBox->setCurrentIndex(output1Index);
-
-                    QByteArray outputDevice2Id = config["outputDevice2Id"].toString().toUtf8();
-                    output2Index = index(outputDevice2Id);
-                    output2ComboBox->setCurrentIndex(output2Index);
-                }
-                else {
-                    //alert user of incorrectly formatted configuration
-                    QMessageBox::critical(this, tr("Error: NoDevIdError"), tr("Failed to parse configuration file %1").arg(fileName));
-                    return;
-                }
-
-                //load the input and output volumes
-                if(config.contains("output1Volume") && config.contains("output2Volume")){
-                    output1Volume = config["output1Volume"].toInt();
-                    output2Volume = config["output2Volume"].toInt();
-                    if(!initial)output1VolumeSlider->setValue(output1Volume);
-                    if(!initial)output2VolumeSlider->setValue(output2Volume);
-                }
-                else {
-                    //alert user of incorrectly formatted configuration
-                    QMessageBox::critical(this, tr("Error: NoVolInfoError"), tr("Failed to parse configuration file %1").arg(fileName));
-                    return;
-                }
-
-                //notify the user if they were the one to load the config manually
-                if(!initial) QMessageBox::information(this, tr("Success"), tr("Configuration loaded successfully"));
-
-                loadedConfig = fileName;
-
-                //connect to the serial port automatically if there is a com port
-                if(portComboBox->count() > 0)connectToSerialPort(false);
-
-                //update the list of known confiurations
-                if(contains(fileName, knownConfigurations)){
-                    //move the currently loaded one to the top
-                    knownConfigurations.remove(index(fileName, knownConfigurations));
-                }
-                knownConfigurations.push_front(fileName);
-
-                updateKnownConfigsMenu();
+        //read the file (JSON, or the binary form of the same document)
+        QJsonObject config;
+        const ConfigFile::Status status = ConfigFile::read(fileName, config);
+        if (status == ConfigFile::Status::CannotOpen) {
+            //alert user of error
+            QMessageBox::critical(this, tr("Error"), tr("Failed to open configuration file %1").arg(fileName));
+            return;
+        }
+        if (status != ConfigFile::Status::Ok) {
+            //alert user of incorrectly formatted configuration
+            QMessageBox::critical(this, tr("Error: NoDocError"), tr("Failed to parse configuration file %1").arg(fileName));
+            return;
+        }
+
+        //check the program version
+        if(config.contains("GLOBAL_PROGRAM_VERSION")){
+            if(config["GLOBAL_PROGRAM_VERSION"] != GLOBAL_PROGRAM_VERSION){
+                //outdated user config
+                QMessageBox::critical(this, "Error: OutdatedConfigError", "The selected configuration file was created by a different version of this program and cannot be loaded.");
+                return;
+            }
+        }
+        else {
+            if(config.contains("outputDevice1Index") && config.contains("outputDevice2Index")){//refactor the configuration file
+                //add GLOBAL_PROGRAM_VERSION
+                config["GLOBAL_PROGRAM_VERSION"] = GLOBAL_PROGRAM_VERSION;
+
+                //change the device indices to id's
+                config["outputDevice1Id"] = QString::fromUtf8(outputDevices.value(config["outputDevice1Index"].toInt()).id());
+                config.remove("outputDevice1Index");
+
+                config["outputDevice2Id"] = QString::fromUtf8(outputDevices.value(config["outputDevice2Index"].toInt()).id());
+                config.remove("outputDevice2Index");
+
+                //write the file
+                ConfigFile::write(fileName, config);
             }
             else {
-                //alert user of incorrectly formatted configuration
-                QMessageBox::critical(this, tr("Error: NoDocError"), tr("Failed to parse configuration file %1").arg(fileName));
+                QMessageBox::critical(this, "Error: Missing GLOBAL_PROGRAM_VERSION", "The selected configuration file is missing GLOBAL_PROGRAM_VERSION.");
                 return;
             }
         }
-        else {
-            //alert user of error
-            QMessageBox::critical(this, tr("Error"), tr("Failed to open configuration file %1").arg(fileName));
+
+        //check everything a configuration needs before anything is changed,
+        //so a broken file never leaves the board half loaded
+        if (!config.contains("sounds") || !config["sounds"].isArray()) {
+            //alert user of incorrectly formatted configuration
+            QMessageBox::critical(this, tr("Error: NoSoundsError"), tr("Failed to parse configuration file %1").arg(fileName));
+            return;
+        }
+        if (!config.contains("serialPort")) {
+            //alert user of incorrectly formatted configuration
+            QMessageBox::critical(this, tr("Error: NoSerialError"), tr("Failed to parse configuration file %1").arg(fileName));
+            return;
+        }
+        if (!config.contains("outputDevice1Id") || !config.contains("outputDevice2Id")) {
+            //alert user of incorrectly formatted configuration
+            QMessageBox::critical(this, tr("Error: NoDevIdError"), tr("Failed to parse configuration file %1").arg(fileName));
             return;
         }
+        if (!config.contains("output1Volume") || !config.contains("output2Volume")) {
+            //alert user of incorrectly formatted configuration
+            QMessageBox::critical(this, tr("Error: NoVolInfoError"), tr("Failed to parse configuration file %1").arg(fileName));
+            return;
+        }
+
+        stageConfig(fileName, config, initial);
     }
 }
 
+//reads the banks of a checked configuration and decodes the sounds of its
+//active bank in the background. nothing that is playing changes until they
+//are all in, then applyConfig() swaps the whole configuration in at once
+void Soundboard::stageConfig(const QString &fileName, const QJsonObject &config, bool initial) {
+    //a configuration still loading is dropped; its sounds are ignored as they arrive
+    pendingSwap = ConfigSwap();
+    pendingSwap.fileName = fileName;
+    pendingSwap.config = config;
+    pendingSwap.initial = initial;
+    pendingSwap.timer.start();
+
+    //the settings the sounds are decoded and measured with (optional). they are
+    //handed to the decoders with the sounds; the current ones stay as they are
+    pendingSwap.resampleQuality = qBound(0, config["resampleQuality"].toInt(Resampler::Best), 2);
+    pendingSwap.normalizeLoudness = config["normalizeLoudness"].toBool(true);
+    pendingSwap.targetLufs = config["targetLufs"].toInt(DEFAULT_TARGET_LUFS);
+    pendingSwap.silenceThresholdDb = config["silenceThresholdDb"].toInt(DEFAULT_SILENCE_THRESHOLD_DB);
+
+    //the banks: pages of sounds for the same buttons (older configs
+    //have a single page, in "sounds" and "trims")
+    QJsonArray bankArray = config["banks"].toArray();
+    if(bankArray.isEmpty()) bankArray.append(QJsonObject{{"sounds", config["sounds"]}, {"trims", config["trims"]}});
+
+    //the board will have at least as many slots as any bank has sounds (it never shrinks)
+    pendingSwap.slotCount = soundFiles.size();
+    for (const QJsonValue &bank : std::as_const(bankArray))
+        pendingSwap.slotCount = std::max<int>(pendingSwap.slotCount, bank.toObject()["sounds"].toArray().size());
+    pendingSwap.slotCount = std::clamp(pendingSwap.slotCount, 1, MAX_SLOTS);
+
+    //the start and end points come with the sounds they apply to
+    //(optional, sounds without them are trimmed automatically)
+    for (const QJsonValue &value : std::as_const(bankArray)) {
+        const QJsonObject object = value.toObject();
+        Bank bank;
+        for (const QJsonValue &sound : object["sounds"].toArray()) bank.sounds.append(sound.toString());
+        resizeBank(bank, pendingSwap.slotCount);
+        QJsonArray trimArray = object["trims"].toArray();
+        for (int i = 0; i < trimArray.size() && i < bank.trims.size(); ++i) {
+            QJsonArray trim = trimArray[i].toArray();
+            if (trim.size() == 2) bank.trims[i] = {trim[0].toInt(-1), trim[1].toInt(-1)};
+        }
+        pendingSwap.banks.append(bank);
+    }
+    pendingSwap.currentBank = qBound(0, config["currentBank"].toInt(), int(pendingSwap.banks.size()) - 1);
+    swapPending = true;
+
+    //nothing is playing yet (startup), so there is nothing to keep going: apply
+    //the settings now and let the sounds arrive one by one
+    if(!audio->isRunning()){
+        applyConfig();
+        return;
+    }
+
+    //missing files and decode errors are reported together once the whole batch is in
+    const Bank &bank = pendingSwap.banks[pendingSwap.currentBank];
+    QList<ImportPipeline::Job> jobs;
+    for (int i = 0; i < bank.sounds.size(); ++i) {
+        if(bank.sounds[i].isEmpty()) continue;
+        ImportPipeline::Job job;
+        job.slot = i;
+        job.bank = CONFIG_SWAP_BANK;
+        job.path = bank.sounds[i];
+        job.residency = budget->initialResidency();
+        job.quality = Resampler::Quality(pendingSwap.resampleQuality);
+        job.findTrim = bank.trims[i][0] < 0 || bank.trims[i][1] < 0;
+        job.silenceThresholdDb = pendingSwap.silenceThresholdDb;
+        jobs.append(job);
+        pendingSwap.loading.insert(i);
+    }
+    if(jobs.isEmpty()) applyConfig();
+    else importer->submit(jobs);
+}
+
+//swaps the staged configuration in. the settings are applied first, then
+//every slot changes at once through the bank switch; voices of the old
+//configuration finish as they were. the serial connection and the output
+//streams are only reopened if the new configuration changes them
+void Soundboard::applyConfig() {
+    swapPending = false;
+    const QJsonObject config = pendingSwap.config;
+    const QString fileName = pendingSwap.fileName;
+    const bool initial = pendingSwap.initial;
+
+    //what sounds are decoded and measured with from now on, and the board's size
+    resampleQuality = pendingSwap.resampleQuality;
+    SampleLoader::setResampleQuality(Resampler::Quality(resampleQuality));
+    normalizeLoudness = pendingSwap.normalizeLoudness;
+    targetLufs = pendingSwap.targetLufs;
+    silenceThresholdDb = pendingSwap.silenceThresholdDb;
+    setSlotCount(pendingSwap.slotCount);
+
+    //every optional setting the configuration leaves out goes back to its default,
+    //so nothing is carried over from the configuration loaded before
+
+    //the buttons held together to switch banks, counting from 1 (optional)
+    auto buttonList = [](const QJsonValue &value, const QList<int> &fallback) {
+        if(!value.isArray()) return fallback;
+        QList<int> buttons;
+        for (const QJsonValue &button : value.toArray()) buttons.append(button.toInt() - 1);
+        return buttons;
+    };
+    prevBankButtons = buttonList(config["prevBankButtons"], DEFAULT_PREV_BANK_BUTTONS);
+    nextBankButtons = buttonList(config["nextBankButtons"], DEFAULT_NEXT_BANK_BUTTONS);
+    serialSource->setBankButtons(prevBankButtons, nextBankButtons);
+
+    //the keys and the MIDI notes that trigger sounds (optional)
+    triggerKeys = DEFAULT_TRIGGER_KEYS;
+    if(config["triggerKeys"].isArray()){
+        triggerKeys.clear();
+        for (const QJsonValue &key : config["triggerKeys"].toArray()) triggerKeys.append(key.toInt());
+    }
+    midiBaseNote = config["midiBaseNote"].toInt(DEFAULT_MIDI_BASE_NOTE);
+#ifdef Q_OS_LINUX
+    keySource->setKeys(triggerKeys);
+#endif
+#ifdef HAVE_ALSA
+    midiSource->setBaseNote(midiBaseNote);
+#endif
+
+    //load the serial port
+    refreshSerialPorts();
+    QString savedPort = config["serialPort"].toString();
+    bool portFound = false;
+    for (const QSerialPortInfo &info : std::as_const(serialPorts)) portFound = portFound || info.systemLocation() == savedPort;
+    if (portFound) selectedPort = savedPort;
+    else qDebug()<<"Error loading serial port";
+
+    //the devices as they are now; the streams are only reopened if one changes
+    const int oldOutput1Index = output1Index, oldOutput2Index = output2Index, oldInputIndex = inputIndex;
+    const bool oldMicBusEnabled = micBusEnabled;
+
+    //load input and output device id
+    output1Index = index(config["outputDevice1Id"].toString().toUtf8());
+    outputDevice1 = outputDevices.value(output1Index, QMediaDevices::defaultAudioOutput());
+    output2Index = index(config["outputDevice2Id"].toString().toUtf8());
+    outputDevice2 = outputDevices.value(output2Index, QMediaDevices::defaultAudioOutput());
+
+    //load the input and output volumes
+    output1Volume = config["output1Volume"].toInt();
+    output2Volume = config["output2Volume"].toInt();
+    audio->setBusVolume(0, scale(output1Volume));
+    audio->setBusVolume(1, scale(output2Volume));
+
+    //load the microphone passthrough settings (optional, older configs don't have them)
+    inputIndex = inputIndexOf(config["inputDeviceId"].toString().toUtf8());
+    inputDevice = inputDevices.value(inputIndex, QMediaDevices::defaultAudioInput());
+    inputGain = config["inputGain"].toInt(DEFAULT_LEVEL);
+    audio->setInputGain(scale(inputGain));
+    micBusEnabled = config["micBusEnabled"].toBool(false);
+
+    //load the routing matrix (optional, defaults to every sound on both outputs)
+    const QJsonArray routeArray = config["routes"].toArray();
+    for (int i = 0; i < slotRoutes.size(); ++i) {
+        const QJsonArray row = routeArray.at(i).toArray();
+        for (int bus = 0; bus < NUM_BUSES; ++bus) {
+            slotRoutes[i][bus] = row.at(bus).toInt(DEFAULT_LEVEL);
+            audio->setRoute(i, bus, scale(slotRoutes[i][bus]));
+        }
+    }
+
+    //load the microphone ducking settings (optional)
+    duckAmount = config["duckAmountDb"].toInt(DEFAULT_DUCK_DEPTH_DB);
+    audio->setDuckingAmount(-duckAmount);
+    duckAttackMs = config["duckAttackMs"].toInt(DEFAULT_DUCK_ATTACK);
+    duckReleaseMs = config["duckReleaseMs"].toInt(DEFAULT_DUCK_RELEASE);
+    audio->setDuckingTimes(duckAttackMs, duckReleaseMs);
+
+    //load the gain smoothing settings (optional)
+    gainRampMs = config["gainRampMs"].toInt(DEFAULT_GAIN_RAMP);
+    fadeMs = config["fadeMs"].toInt(DEFAULT_FADE);
+    audio->setGainRampTime(gainRampMs);
+    audio->setFadeTime(fadeMs);
+    duckingEnabled = config["duckingEnabled"].toBool(false);
+    audio->setDuckingEnabled(duckingEnabled);
+
+    //before the streams open (startup) the sounds are converted straight to the rate they will run at
+    if(!audio->isRunning()) SampleLoader::setTargetRate(audio->outputRate(outputDevice1.description()));
+
+    //swap in the sounds. slots the config has no sound for are cleared and
+    //sounds that weren't decoded ahead load in the background
+    banks = pendingSwap.banks;
+    pendingSwap.banks.clear();
+    activateBank(pendingSwap.currentBank);
+
+    //reopen the streams if the configuration moves them to other devices. after
+    //the swap, so a device running at another rate converts the new sounds again
+    const bool inputChanged = micBusEnabled != oldMicBusEnabled || (micBusEnabled && inputIndex != oldInputIndex);
+    if(audio->isRunning() && (output1Index != oldOutput1Index || output2Index != oldOutput2Index || inputChanged)) restartAudio();
+    qCDebug(lcTiming) << "Configuration" << fileName << "swapped in" << pendingSwap.timer.elapsed() << "ms after it was opened";
+
+    //notify the user if they were the one to load the config manually
+    if(!initial) QMessageBox::information(this, tr("Success"), tr("Configuration loaded successfully"));
+
+    loadedConfig = fileName;
+
+    //connect to the serial port automatically if there is a com port, unless
+    //it is already connected to it (reopening would reset the device)
+    const bool connected = serialSource->isOpen() && serialSource->portName() == selectedPort;
+    if(!serialPorts.isEmpty() && !connected) connectToSerialPort(false);
+
+    //applying the file isn't a change to it
+    savedConfig = config;
+    configDirty = false;
+    configJournal.clear();
+    autosaveTimer->stop();
+
+    //update the list of known confiurations
+    if(contains(fileName, knownConfigurations)){
+        //move the currently loaded one to the top
+        knownConfigurations.remove(index(fileName, knownConfigurations));
+    }
+    knownConfigurations.push_front(fileName);
+
+    //show the new settings
+    syncInterface();
+}
+
 //save initialization data
 void Soundboard::saveInitData() {
     //initialize the file object
@@ -940,12 +1389,12 @@ void Soundboard::saveInitData() {
     config["cfgToLoadAtStartup"] = cfgToLoadAtStartup;
     config["saveCfgAtShutdown"] = saveCfgAtShutdown;
     config["startMinimized"] = startMinimized;
+    config["memoryBudgetMb"] = memoryBudgetMb;
 
-    //write the file
-    QFile file(fileName);
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(QJsonDocument(config).toJson());
-        file.close();
+    //write the file (to a temporary next to it, renamed over the old one once complete)
+    QSaveFile file(fileName);
+    if (file.open(QIODevice::WriteOnly)) file.write(QJsonDocument(config).toJson());
+    if (file.commit()) {
         // qDebug()<<"init data saved!";
     }
     else {
@@ -953,6 +1402,8 @@ void Soundboard::saveInitData() {
         QMessageBox::critical(this, tr("Error"), tr("Failed to save initialization configuration file."));
     }
 
+    //the play counts that rank sounds for the memory budget live next to it
+    budget->saveUsage(QCoreApplication::applicationDirPath()+"/usage.json");
 }
 
 //load initialization data
@@ -1018,6 +1469,10 @@ void Soundboard::loadInitData(){
             err = true;
         }
 
+        //grab the memory budget for decoded sounds (optional, older files lack it)
+        if(initConfig.contains("memoryBudgetMb"))
+            memoryBudgetMb = initConfig["memoryBudgetMb"].toInt();
+
         //check the program version
         if(initConfig.contains("GLOBAL_PROGRAM_VERSION") && initConfig["GLOBAL_PROGRAM_VERSION"] != GLOBAL_PROGRAM_VERSION){
             //update the program version
@@ -1157,87 +1612,24 @@ void Soundboard::startupConfigSelected(const QString& cfg){
     //prompt the user
     QMessageBox::StandardButton choice = QMessageBox::question(this, tr("Question"), tr("Do you want to load this configuration right now?"));
 
-    if(choice == QMessageBox::Yes){
-        loadConfig(true);
-        output1VolumeSlider->setValue(output1Volume);
-        output2VolumeSlider->setValue(output2Volume);
-    }
+    //the sliders follow once the configuration has been swapped in
+    if(choice == QMessageBox::Yes) loadConfig(true);
 }
 
-//checks if the loaded configuration matches the selected settings
+//checks if the selected settings differ from the loaded configuration
 bool Soundboard::configChanged(){
-    if(loadedConfig == "") return true;
-
-    //ask the user which file to load
-    QString fileName = loadedConfig;
-
-    //create the file object
-    QFile file(fileName);
-    //attempt to read the file
-    if (file.open(QIODevice::ReadOnly)) {
-        //read the file as a json then close it
-        QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-        file.close();
-
-        //check if the file is formatted properly then load all of its data
-        if (doc.isObject()) {
-            QJsonObject config = doc.object();
-            //check the sounds
-            if (config.contains("sounds") && config["sounds"].isArray()) {
-                QJsonArray soundArray = config["sounds"].toArray();
-                for (int i = 0; i < soundArray.size() && i < 10; ++i) {
-                    //verify that the file exists
-                    if(!QFile(soundArray[i].toString()).exists())
-                        return true; //the config file is broken and needs to be overwritten
-                    if(soundFiles[i] != soundArray[i].toString())
-                        return true; //mismatch in sounds
-                }
-            }
-            else return true; //the config file is broken and needs to be overwritten
-
-            //check the serial port
-            if (config.contains("serialPort")) {
-                QString savedPort = config["serialPort"].toString();
-                if(portComboBox->findData(savedPort) != portComboBox->currentIndex())
-                    return true; //mismatch in port
-            }
-            else return true; //the config file is broken and needs to be overwritten
-
-            //check input and output devices
-            if(config.contains("outputDevice1Index") && config.contains("outputDevice2Index")){
-                int outputDevice1Index = config["outputDevice1Index"].toInt();
-                if((output1ComboBox->currentIndex() != outputDevice1Index))
-                    return true; //mismatch in dev 1
-                int outputDevice2Index = config["outputDevice2Index"].toInt();
-                if((output2ComboBox->currentIndex() != outputDevice2Index))
-                    return true; //mismatch in dev 2
-            }
-            else return true; //the config file is broken and needs to be overwritten
-
-            //check the input and output volumes
-            if(config.contains("output1Volume") && config.contains("output2Volume")){
-                if(config["output1Volume"].toInt() != output1Volume)
-                    return true; //mismatch in out1 vol
-                if(config["output2Volume"].toInt() != output2Volume)
-                    return true; //mismatch in out2 vol
-            }
-            else return true; //the config file is broken and needs to be overwritten
-        }
-        else return true; //the config file is broken and needs to be overwritten
-    }
-    else return true; //the config file is broken and needs to be overwritten
-    //loaded configuration matches current settings
-    return false;
+    return loadedConfig == "" || configDirty;
 }
 
 //updates the known configurations in the menu bar
 void Soundboard::updateKnownConfigsMenu(){
-    //clear the menu
+    //clear the menu (there is none while in the tray)
+    if(!startupConfigMenu) return;
     startupConfigMenu->clear();
     startupConfigMenu->setToolTipsVisible(true);
 
     //re-add the option to not load any config at startup
-    QAction *noStartupConfigAction = new QAction(tr("None"), this);
+    QAction *noStartupConfigAction = new QAction(tr("None"), startupConfigMenu);
     noStartupConfigAction->setCheckable(true);
     noStartupConfigAction->setChecked(cfgToLoadAtStartup == "NONE");
     noStartupConfigAction->setToolTip(tr("Manually load a configuration file first to see it in this list!"));
@@ -1248,7 +1640,7 @@ void Soundboard::updateKnownConfigsMenu(){
 
     //add the rest of the items of interest
     for(const QString &s:std::as_const(knownConfigurations)){
-        QAction *action = new QAction(extractFileName(s), this);
+        QAction *action = new QAction(extractFileName(s), startupConfigMenu);
         action->setCheckable(true);
         action->setChecked(cfgToLoadAtStartup == s);
         action->setToolTip(s);
@@ -1260,22 +1652,17 @@ void Soundboard::updateKnownConfigsMenu(){
 }
 
 void Soundboard::populateAudioDevices() {
-    //clear current contents of combo boxes
-    output1ComboBox->clear();
-    output2ComboBox->clear();
-
-    //list available output devices
+    //list available output and input devices
     outputDevices = QMediaDevices::audioOutputs();
-    for (const auto &device : outputDevices) {
-        QVariant variant = QVariant::fromValue(device);
-        output1ComboBox->addItem(device.description(), variant);
-        output2ComboBox->addItem(device.description(), variant);
-    }
+    inputDevices = QMediaDevices::audioInputs();
 
-    //set the selected devices as the current combo box indices
-    output1ComboBox->setCurrentIndex(output1Index);
-    output2ComboBox->setCurrentIndex(output2Index);
+    //the selected devices
+    outputDevice1 = outputDevices.value(output1Index, QMediaDevices::defaultAudioOutput());
+    outputDevice2 = outputDevices.value(output2Index, QMediaDevices::defaultAudioOutput());
+    inputDevice = inputDevices.value(inputIndex, QMediaDevices::defaultAudioInput());
 
+    //fill the combo boxes
+    syncInterface();
 }
 
 //triggered whenever the volume slider is changed
@@ -1285,9 +1672,10 @@ void Soundboard::updateOutput1VolumeLabel(int value) {
 
     //update the parent class' volume value
     output1Volume = value;
+    markConfigDirty("output1Volume");
 
-    //update the parent class' audio output (actual) volume
-    device1AudioOutput->setVolume(value);
+    //update the engine's output 1 (actual) volume
+    audio->setBusVolume(0, scale(value));
 }
 
 //triggered whenever the volume slider is changed
@@ -1297,9 +1685,10 @@ void Soundboard::updateOutput2VolumeLabel(int value) {
 
     //update the parent class' volume value
     output2Volume = value;
+    markConfigDirty("output2Volume");
 
-    //update the parent class' audio output (actual) volume
-    device2AudioOutput->setVolume(value);
+    //update the engine's output 2 (actual) volume
+    audio->setBusVolume(1, scale(value));
 }
 
 //reset input volume to 0%
@@ -1327,6 +1716,9 @@ void Soundboard::combo1Changed(int newIndex) {
     outputDevice1 = QMediaDevices::audioOutputs().at(output1ComboBox->currentIndex());
     //update the device index
     output1Index = output1ComboBox->currentIndex();
+    markConfigDirty("outputDevice1Id");
+    //reopen the streams on the new device
+    if(audio->isRunning()) restartAudio();
 }
 
 //triggered when the user changes the selected audio device #2
@@ -1342,6 +1734,283 @@ void Soundboard::combo2Changed(int newIndex) {
     outputDevice2 = QMediaDevices::audioOutputs().at(output2ComboBox->currentIndex());
     //update the device index
     output2Index = output2ComboBox->currentIndex();
+    markConfigDirty("outputDevice2Id");
+    //reopen the streams on the new device
+    if(audio->isRunning()) restartAudio();
+}
+
+//triggered when the user changes the selected input (microphone) device
+void Soundboard::inputComboChanged(int newIndex) {
+    if(newIndex < 0 || newIndex >= inputDevices.size()) return;
+    //update the input device
+    inputDevice = inputDevices.at(newIndex);
+    //update the device index
+    inputIndex = newIndex;
+    markConfigDirty("inputDeviceId");
+    //the input is only opened while the mic bus is on
+    if(micBusEnabled && audio->isRunning()) restartAudio();
+}
+
+//triggered when the microphone passthrough is turned on or off
+void Soundboard::micBusToggled(bool checked) {
+    micBusEnabled = checked;
+    markConfigDirty("micBusEnabled");
+    inputComboBox->setEnabled(checked);
+    inputGainSlider->setEnabled(checked);
+    duckingCheckBox->setEnabled(checked);
+    duckAmountSlider->setEnabled(checked);
+    if(audio->isRunning()) restartAudio();
+}
+
+//triggered when microphone ducking is turned on or off
+void Soundboard::duckingToggled(bool checked) {
+    duckingEnabled = checked;
+    audio->setDuckingEnabled(checked);
+    markConfigDirty("duckingEnabled");
+}
+
+//triggered whenever the ducking amount slider is changed
+void Soundboard::updateDuckAmountLabel(int value) {
+    //update the label
+    duckAmountValueLabel->setText(QString("-%1 dB").arg(value));
+
+    //update the parent class' ducking value
+    duckAmount = value;
+    markConfigDirty("duckAmountDb");
+
+    //update the engine's ducking amount
+    audio->setDuckingAmount(-value);
+}
+
+//triggered whenever the input gain slider is changed
+void Soundboard::updateInputGainLabel(int value) {
+    //update the label
+    inputGainValueLabel->setText(QString("%1 %").arg(value));
+
+    //update the parent class' gain value
+    inputGain = value;
+    markConfigDirty("inputGain");
+
+    //update the engine's microphone gain
+    audio->setInputGain(scale(value));
+}
+
+//reset input gain to 100%
+void Soundboard::resetInputGain() {
+    inputGainSlider->setValue(100);
+    updateInputGainLabel(100);
+}
+
+//hands the selected devices to the audio engine and (re)opens its streams
+void Soundboard::restartAudio() {
+    audio->setOutputDevice(0, outputDevice1.description());
+    audio->setOutputDevice(1, outputDevice2.description());
+    audio->setInputDevice(inputDevice.description());
+    audio->setMicBusEnabled(micBusEnabled);
+    audio->setBusVolume(0, scale(output1Volume));
+    audio->setBusVolume(1, scale(output2Volume));
+    audio->setInputGain(scale(inputGain));
+    audio->setDuckingEnabled(duckingEnabled);
+    audio->setDuckingAmount(-duckAmount);
+    audio->start();
+}
+
+//opens the routing matrix editor
+void Soundboard::openRouting() {
+    RoutingDialog *routingDialog = new RoutingDialog(soundFiles, slotRoutes, this);
+    connect(routingDialog, &RoutingDialog::routeChanged, this, &Soundboard::routeChanged);
+    routingDialog->setAttribute(Qt::WA_DeleteOnClose);
+    routingDialog->exec();
+}
+
+//triggered when the gain of a sound on an output is changed
+void Soundboard::routeChanged(int slot, int bus, int percent) {
+    slotRoutes[slot][bus] = percent;
+    audio->setRoute(slot, bus, scale(percent));
+    markConfigDirty("routes");
+}
+
+//decodes the sound assigned to a slot and hands it to the audio engine
+void Soundboard::loadSound(int index) {
+    loadSounds({index});
+}
+
+//queues the sounds of several slots for the import pipeline; they load in
+//parallel off the GUI thread and arrive one by one in soundImported()
+void Soundboard::loadSounds(const QList<int> &indices) {
+    QList<ImportPipeline::Job> jobs;
+    for (int index : indices) {
+        if(soundFiles[index].isEmpty()){
+            budget->place(index, QString(), nullptr);
+            audio->setTrim(index, 0, 0);
+            audio->setSlotGain(index, 1.0f);
+            continue;
+        }
+        ImportPipeline::Job job;
+        job.slot = index;
+        job.bank = currentBank;
+        job.path = soundFiles[index];
+        job.residency = budget->initialResidency();
+        job.findTrim = slotTrims[index][0] < 0 || slotTrims[index][1] < 0;
+        job.silenceThresholdDb = silenceThresholdDb;
+        jobs.append(job);
+    }
+    importer->submit(jobs);
+    watcher->setFiles(soundFiles);
+}
+
+//some assigned files were changed on disk; reload only the slots that use them.
+//voices already playing finish on the old sound, which the engine frees afterwards
+void Soundboard::soundFilesChanged(const QStringList &paths) {
+    QList<int> indices;
+    for (int i = 0; i < soundFiles.size(); ++i) {
+        if(!paths.contains(soundFiles[i])) continue;
+        slotTrims[i] = {-1, -1}; //the old start and end points may no longer fit
+        markConfigDirty("trims");
+        indices.append(i);
+    }
+    loadSounds(indices);
+
+    //preloaded banks drop their copy and load it again
+    for (int b = 0; b < banks.size(); ++b) {
+        if(b == currentBank) continue;
+        Bank &bank = banks[b];
+        for (int i = 0; i < bank.sounds.size(); ++i) {
+            if(!paths.contains(bank.sounds[i])) continue;
+            bank.trims[i] = {-1, -1};
+            bank.samples[i] = nullptr;
+        }
+    }
+    preloadBanks();
+}
+
+//the streams were opened on a device running at another rate. every sound is
+//converted to it again: the active bank is reloaded, the preloaded ones dropped
+//and loaded again, and a configuration being swapped in is staged again
+void Soundboard::sampleRateChanged(int rate) {
+    if(rate == SampleLoader::targetRate()) return;
+    SampleLoader::setTargetRate(rate);
+    QList<int> indices;
+    for (int i = 0; i < soundFiles.size(); ++i) indices.append(i);
+    loadSounds(indices);
+    for (Bank &bank : banks) bank.samples.fill(nullptr);
+    preloadBanks();
+    if(swapPending) stageConfig(pendingSwap.fileName, pendingSwap.config, pendingSwap.initial);
+}
+
+//a sound finished loading on the import pipeline
+void Soundboard::soundImported(const ImportPipeline::Result &result) {
+    //converted for a rate the streams no longer run at; sampleRateChanged() queued it again
+    if(result.sample && result.sample->sampleRate != SampleLoader::targetRate()) return;
+
+    //a sound for a configuration being swapped in; it goes live with the rest of them
+    if(result.bank == CONFIG_SWAP_BANK){
+        if(!swapPending || !pendingSwap.loading.contains(result.slot)) return;
+        Bank &bank = pendingSwap.banks[pendingSwap.currentBank];
+        if(bank.sounds[result.slot] != result.path) return;
+        pendingSwap.loading.remove(result.slot);
+        if(result.sample){
+            bank.samples[result.slot] = result.sample;
+            if((bank.trims[result.slot][0] < 0 || bank.trims[result.slot][1] < 0) && result.trimStart >= 0)
+                bank.trims[result.slot] = detectedTrim(result);
+            bank.gains[result.slot] = 1.0f;
+            if(pendingSwap.normalizeLoudness) loudness->analyze(result.slot, result.path, result.sample, result.quality);
+        }
+        //a sound that has disappeared is dropped from the slot; the error is reported with the batch
+        else if(!QFile::exists(result.path)) bank.sounds[result.slot] = "";
+        if(pendingSwap.loading.isEmpty()) applyConfig();
+        return;
+    }
+
+    //a sound for another bank is kept ready for when that bank is switched to
+    if(result.bank != currentBank){
+        if(result.bank < 0 || result.bank >= banks.size() || !result.sample) return;
+        Bank &bank = banks[result.bank];
+        if(result.slot < 0 || result.slot >= bank.sounds.size() || bank.sounds[result.slot] != result.path) return;
+        bank.samples[result.slot] = result.sample;
+        if((bank.trims[result.slot][0] < 0 || bank.trims[result.slot][1] < 0) && result.trimStart >= 0){
+            bank.trims[result.slot] = detectedTrim(result);
+            markConfigDirty("banks");
+        }
+        bank.gains[result.slot] = 1.0f;
+        if(normalizeLoudness) loudness->analyze(result.slot, result.path, result.sample, result.quality);
+        return;
+    }
+
+    //the slot may have been given another sound while this one was loading
+    if(result.slot < 0 || result.slot >= soundFiles.size() || soundFiles[result.slot] != result.path) return;
+    const int index = result.slot;
+
+    if(!result.sample){
+        //a sound that has disappeared is dropped from the slot; the error is reported with the batch
+        if(!QFile::exists(result.path)){
+            soundFiles[index] = "";
+            showSound(index);
+            watcher->setFiles(soundFiles);
+        }
+        budget->place(index, QString(), nullptr);
+        return;
+    }
+    budget->place(index, result.path, result.sample);
+
+    //skip the silence many clips start and end with, which is heard as trigger latency.
+    //detected once on import and kept in the config, so it can be adjusted by hand
+    if((slotTrims[index][0] < 0 || slotTrims[index][1] < 0) && result.trimStart >= 0){
+        slotTrims[index] = detectedTrim(result);
+        markConfigDirty("trims");
+        if(result.trimStart > 0) qCDebug(lcTiming) << "Trimmed" << result.trimStart * 1000 / result.sample->sampleRate << "ms of leading silence from" << result.path;
+    }
+    const int rate = result.sample->sampleRate;
+    if(slotTrims[index][0] >= 0 && slotTrims[index][1] >= 0)
+        audio->setTrim(index, qint64(slotTrims[index][0]) * rate / 1000, qint64(slotTrims[index][1]) * rate / 1000);
+
+    //the gain is applied once the measurement comes back; until then the sound plays as is
+    audio->setSlotGain(index, 1.0f);
+    if(normalizeLoudness) loudness->analyze(index, result.path, result.sample, result.quality);
+}
+
+//shows how far a batch of sounds has loaded
+void Soundboard::importProgress(int done, int total) {
+    if(!sbWidget) return; //nowhere to show it while in the tray
+    if(done < total) statusBar()->showMessage(tr("Loading sounds... %1/%2").arg(done).arg(total));
+    else statusBar()->clearMessage();
+}
+
+//a batch of sounds has loaded; report every failure in one message
+void Soundboard::importFinished(const QStringList &errors, qint64 elapsedMs) {
+    qCDebug(lcTiming) << "Sounds ready in" << elapsedMs << "ms";
+    if(!StartupProfile::isReady() && audio->isRunning()){
+        StartupProfile::end("sample cache warm");
+        StartupProfile::ready();
+    }
+    const SamplePool::Stats pool = SamplePool::stats();
+    qCDebug(lcTiming) << "Sample memory:" << pool.references << "references to" << pool.uniqueSamples << "samples, dedup ratio"
+             << pool.ratio() << "," << pool.bytesSaved() / 1024 << "KiB saved";
+
+    if(!errors.isEmpty())
+        QMessageBox::critical(this, tr("Error: BadSoundError"), tr("Some sounds could not be loaded:\n%1").arg(errors.join("\n")));
+}
+
+//a sound's loudness was measured; bring it to the target level
+void Soundboard::loudnessMeasured(int slot, const QString &path, LoudnessAnalyzer::Measurement measurement){
+    if(slot < 0) return;
+
+    //a sound of a configuration being swapped in is levelled with that configuration's settings
+    if(swapPending && pendingSwap.normalizeLoudness){
+        Bank &bank = pendingSwap.banks[pendingSwap.currentBank];
+        if(slot < bank.sounds.size() && bank.sounds[slot] == path)
+            bank.gains[slot] = LoudnessAnalyzer::normalizationGain(measurement, pendingSwap.targetLufs);
+    }
+    if(!normalizeLoudness) return;
+    const float gain = LoudnessAnalyzer::normalizationGain(measurement, targetLufs);
+
+    //the sound may be in another bank, or the slot may have been given another
+    //sound while it was being measured
+    for (int b = 0; b < banks.size(); ++b) {
+        if(b != currentBank && slot < banks[b].sounds.size() && banks[b].sounds[slot] == path) banks[b].gains[slot] = gain;
+    }
+    if(slot >= soundFiles.size() || soundFiles[slot] != path) return;
+    audio->setSlotGain(slot, gain);
 }
 
 //tells the user how to add this program to their computer's startup folder
@@ -1360,3 +2029,12 @@ int Soundboard::index(QByteArray deviceId){
     }
     return 0;
 }
+
+int Soundboard::inputIndexOf(QByteArray deviceId){
+    for (int i = 0; i < inputDevices.count(); ++i) {
+        if (inputDevices[i].id() == deviceId) {
+            return i;
+        }
+    }
+    return 0;
+}
@@ -2,18 +2,36 @@
 #define SOUNDBOARD_H
 
 #include "soundboardwidget.h"
+#include "boardconfig.h"
+#include "serialsource.h"
+#include "controlserver.h"
+#include "audiomanager.h"
+#include "memorybudget.h"
+#include "loudnessanalyzer.h"
+#include "importpipeline.h"
+#include "soundwatcher.h"
+#include "routingdialog.h"
+#include "sampleloader.h"
+#include "samplepool.h"
 #include "startuphelp.h"
+#include "startupprofile.h"
+#include "configfile.h"
+#ifdef Q_OS_LINUX
+#include "evdevsource.h"
+#endif
+#ifdef HAVE_ALSA
+#include "midisource.h"
+#endif
 
 #include <QtSerialPort/QSerialPortInfo>
 #include <QtSerialPort/QSerialPort>
 #include <QCoreApplication>
 #include <QSystemTrayIcon>
+#include <QElapsedTimer>
 #include <QJsonDocument>
 #include <QMediaDevices>
-#include <QMediaPlayer>
 #include <QApplication>
 #include <QAudioDevice>
-#include <QAudioOutput>
 #include <QPushButton>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -24,12 +42,21 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QComboBox>
+#include <QCheckBox>
+#include <QSignalBlocker>
+#include <QThreadPool>
+#include <QStatusBar>
+#include <QSaveFile>
+#include <QTimer>
 #include <QMenuBar>
 #include <QPointer>
 #include <QThread>
 #include <QObject>
 #include <QFile>
 #include <QMenu>
+#include <QSet>
+
+#include <algorithm>
 
 #ifdef Q_OS_WIN
 #include <QSettings>
@@ -40,7 +67,14 @@
 #include <QStandardPaths>
 #endif
 
-constexpr char GLOBAL_PROGRAM_VERSION[] = "1.0.1";
+//bank tag of sounds decoded for a configuration that is still being loaded
+constexpr int CONFIG_SWAP_BANK = -1;
+
+//quiet time after the last change before the loaded config is saved automatically
+constexpr int AUTOSAVE_DELAY_MS = 2000;
+
+//time in the tray before the window's widgets are destroyed to free their memory
+constexpr int TRAY_TEARDOWN_DELAY_MS = 30000;
 
 class Soundboard : public QMainWindow
 {
@@ -48,12 +82,20 @@ class Soundboard : public QMainWindow
 public:
     explicit Soundboard(QWidget *parent = nullptr);
     ~Soundboard();
-    int output1Volume, output2Volume, output1Index = 0, output2Index = 1;
+    int output1Volume = DEFAULT_LEVEL, output2Volume = DEFAULT_LEVEL, output1Index = 0, output2Index = 1;
     bool startMinimized;
-    QAudioDevice outputDevice1 = QMediaDevices::defaultAudioOutput(),
-                 outputDevice2 = QMediaDevices::audioOutputs().at(1);
-    QAudioOutput *device1AudioOutput, *device2AudioOutput;
+    QAudioDevice outputDevice1, outputDevice2, inputDevice; //set once the devices are listed
+    int inputGain = DEFAULT_LEVEL, inputIndex = 0;
+    int duckAmount = DEFAULT_DUCK_DEPTH_DB, duckAttackMs = DEFAULT_DUCK_ATTACK, duckReleaseMs = DEFAULT_DUCK_RELEASE;
+    int gainRampMs = DEFAULT_GAIN_RAMP, fadeMs = DEFAULT_FADE;
+    int memoryBudgetMb = DEFAULT_MEMORY_BUDGET_MB;
+    int silenceThresholdDb = DEFAULT_SILENCE_THRESHOLD_DB;
+    bool normalizeLoudness = true;
+    int targetLufs = DEFAULT_TARGET_LUFS;
+    int resampleQuality = Resampler::Best;
+    bool micBusEnabled = false, duckingEnabled = false;
     void publicAppExitPoint();
+    void startSubsystems();
 
 protected:
     void closeEvent(QCloseEvent *event) override; //triggers when the app is closed
@@ -61,13 +103,14 @@ protected:
 
 private slots:
     void refreshSerialPorts();
+    void listSerialPorts(const QList<QSerialPortInfo>&);
+    void finishStartup();
     void connectToSerialPort(bool);
     void disconnectSerialPort(bool, bool);
     void selectSound(int index);
     void fileDropped(int, const QString&);
-    void receiveSerialData();
-    void sendSerialData(const QString &);
     void playSound(int index);
+    void handleTriggers();
     void soundEnd(int index);
     void saveConfig(bool);
     void loadConfig(bool);
@@ -83,29 +126,104 @@ private slots:
     void resetOutput2Volume();
     void combo1Changed(int);
     void combo2Changed(int);
+    void inputComboChanged(int);
+    void micBusToggled(bool);
+    void updateInputGainLabel(int);
+    void resetInputGain();
+    void duckingToggled(bool);
+    void updateDuckAmountLabel(int);
+    void restartAudio();
+    void openRouting();
+    void routeChanged(int, int, int);
+    void loudnessMeasured(int, const QString&, LoudnessAnalyzer::Measurement);
+    void soundImported(const ImportPipeline::Result&);
+    void importProgress(int, int);
+    void importFinished(const QStringList&, qint64);
+    void soundFilesChanged(const QStringList&);
+    void sampleRateChanged(int);
     void openStartupHelp();
+    void teardownInterface();
 private:
-    SoundboardWidget *sbWidget;
     StartupHelp *startupHelpBox;
     // const QList<qint32> baudRates = {300, 600, 750, 1200, 2400, 4800, 9600, 19200, 31250, 38400, 57600, 74880, 115200, 230400, 250000, 460800, 500000, 921600, 1000000, 2000000};//common baud rates to attempt for auto-discovery
-    QStringList soundFiles = QStringList(10);
+    //per-slot state, one entry per slot (see setSlotCount)
+    QStringList soundFiles;
+    QList<QList<int>> slotRoutes; //per-sound gain (%) on each output
+    QList<QList<int>> slotTrims; //per-sound start/end points (ms), -1 until detected
+    //a page of sounds for the same buttons. the active bank lives in soundFiles,
+    //slotTrims and the engine; its entry here is only refreshed when switching away
+    struct Bank {
+        QStringList sounds;
+        QList<QList<int>> trims;
+        QList<SamplePtr> samples; //loaded ahead of a switch, empty while the bank is far away
+        QList<float> gains;       //loudness normalization of each sound
+    };
+    QList<Bank> banks = {Bank()};
+    int currentBank = 0;
+    QList<int> prevBankButtons = DEFAULT_PREV_BANK_BUTTONS, nextBankButtons = DEFAULT_NEXT_BANK_BUTTONS;
+    QList<int> triggerKeys = DEFAULT_TRIGGER_KEYS; //key code that triggers each slot, 0 for none
+    int midiBaseNote = DEFAULT_MIDI_BASE_NOTE;
+    QLabel *bankLabel = nullptr;
+    //a configuration decoding in the background while the current one keeps playing
+    struct ConfigSwap {
+        QString fileName;
+        QJsonObject config;
+        bool initial = false;
+        QList<Bank> banks;
+        int currentBank = 0;
+        int slotCount = 0; //the board's slots once it is applied
+        //what its sounds are decoded and measured with; live only once it is applied
+        int resampleQuality = Resampler::Best;
+        bool normalizeLoudness = true;
+        int targetLufs = DEFAULT_TARGET_LUFS;
+        int silenceThresholdDb = DEFAULT_SILENCE_THRESHOLD_DB;
+        QSet<int> loading; //slots of its active bank still decoding
+        QElapsedTimer timer;
+    };
+    ConfigSwap pendingSwap;
+    bool swapPending = false;
+    //the loaded config as last read or written, and what has changed since
+    QJsonObject savedConfig;
+    bool configDirty = false;
+    QStringList configJournal; //config keys changed since the last save, in order
+    QTimer *autosaveTimer;
     QStringList knownConfigurations = QStringList();
-    QString serialData, oldSerialData, s1, s2;
     QString cfgToLoadAtStartup, loadedConfig;
-    QList<QMediaPlayer*> device1MediaPlayers, device2MediaPlayers;
-    QList<QAudioDevice> outputDevices;
+    AudioManager *audio;
+    MemoryBudget *budget;
+    LoudnessAnalyzer *loudness;
+    ImportPipeline *importer;
+    SoundWatcher *watcher;
+    ControlServer *control;
+    QList<QAudioDevice> outputDevices, inputDevices;
+    QList<QSerialPortInfo> serialPorts;
+    QString selectedPort; //system location of the port to connect to
+    bool serialPortsListed = false;
     QSerialPort::SerialPortError serialError = QSerialPort::SerialPortError::NoError;
-    QSerialPort *serial;
-    QComboBox *portComboBox;
+    TriggerQueue *triggers;
+    SerialSource *serialSource; //button scans in, led states out
+#ifdef Q_OS_LINUX
+    EvdevSource *keySource;
+#endif
+#ifdef HAVE_ALSA
+    MidiSource *midiSource;
+#endif
+    QComboBox *portComboBox = nullptr;
     QPointer<QMessageBox> errorBox = nullptr;
     QIcon *connectionStatusIcon_NONE, *connectionStatusIcon_TRUE, *connectionStatusIcon_ERR_;
-    QLabel *connectionStatusIconWrapper;
+    QIcon *connectionIcon; //the connection status, kept for when the widgets are rebuilt
+    QString connectionToolTip;
+    QTimer *teardownTimer;
+    //the window's widgets; all nullptr while torn down in the tray
+    SoundboardWidget *sbWidget = nullptr;
+    QLabel *connectionStatusIconWrapper = nullptr;
     QSystemTrayIcon *trayIcon;
-    QMenu *trayMenu, *startupConfigMenu;
-    QComboBox *output1ComboBox, *output2ComboBox;
-    QSlider *output1VolumeSlider, *output2VolumeSlider;
-    QLabel *output1VolumeValueLabel, *output2VolumeValueLabel, *outputHelpLabel;
-    const int currentBaudRate = 115200;
+    QMenu *trayMenu, *startupConfigMenu = nullptr;
+    QComboBox *output1ComboBox = nullptr, *output2ComboBox = nullptr, *inputComboBox = nullptr;
+    QSlider *output1VolumeSlider = nullptr, *output2VolumeSlider = nullptr, *inputGainSlider = nullptr, *duckAmountSlider = nullptr;
+    QLabel *output1VolumeValueLabel = nullptr, *output2VolumeValueLabel = nullptr, *inputGainValueLabel = nullptr, *duckAmountValueLabel = nullptr, *outputHelpLabel = nullptr;
+    QCheckBox *micBusCheckBox = nullptr, *duckingCheckBox = nullptr;
+    const int currentBaudRate = BOARD_BAUD_RATE;
     bool loadCfgAtStartup;
     bool saveCfgAtShutdown;
 
@@ -114,10 +232,33 @@ private:
     bool contains(const QString&, QStringList);
     bool contains(const QString&, QList<QAction *>);
     bool configChanged();
+    bool writeConfig(const QString&);
+    void markConfigDirty(const QString&);
     qsizetype index(const QString&, QStringList);
     QAction* index(const QString& , QList<QAction*>);
     int index(QByteArray);
+    int inputIndexOf(QByteArray);
     void updateKnownConfigsMenu();
+    void buildInterface();
+    void syncInterface();
+    void setConnectionStatus(QIcon*, const QString&);
+    void showSound(int);
+    void loadSound(int);
+    void loadSounds(const QList<int>&);
+    void setSlotCount(int);
+    void setLedTable(const QList<int>&);
+    void setLed(int, bool);
+    void soundTriggered(int);
+    void switchBank(int);
+    void activateBank(int);
+    void storeActiveBank(bool);
+    void preloadBanks();
+    void resizeBank(Bank&, int = -1);
+    void addBank();
+    void removeBank();
+    void updateBankLabel();
+    void stageConfig(const QString&, const QJsonObject&, bool);
+    void applyConfig();
     float scale(int);
 signals:
     void sendSerial(QString);
@@ -0,0 +1,432 @@
+#include "soundboarddaemon.h"
+#include "startupprofile.h"
+
+#include <QCoreApplication>
+#include <QMediaDevices>
+#include <QAudioDevice>
+#include <QJsonArray>
+#include <QDebug>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <csignal>
+#endif
+
+#define RECONNECT_INTERVAL_MS 2000 // How often a device that is missing or was unplugged is looked for again
+#define SIGNAL_POLL_MS 200 // How often a request to stop is checked for
+
+#ifdef Q_OS_UNIX
+//set by SIGINT and SIGTERM; a handler can do nothing else safely, so the event loop polls it
+static volatile std::sig_atomic_t stopRequested = 0;
+#endif
+
+//the name the engine opens a device by; the first device if 'id' is gone, as in the window
+static QString deviceName(const QList<QAudioDevice> &devices, const QString &id) {
+    for (const QAudioDevice &device : devices) {
+        if (device.id() == id.toUtf8()) return device.description();
+    }
+    return devices.isEmpty() ? QString() : devices.first().description();
+}
+
+SoundboardDaemon::SoundboardDaemon(const QString &configFile, const QString &controlName, QObject *parent)
+    : QObject(parent), configFile(configFile), controlName(controlName)
+{
+    audio = new AudioManager(this);
+    connect(audio, &AudioManager::voiceFinished, this, &SoundboardDaemon::soundEnd);
+    connect(audio, &AudioManager::errorOccurred, this, [](const QString &error){
+        qWarning() << "Audio engine:" << error;
+    });
+
+    budget = new MemoryBudget(audio, this);
+    budget->setBudget(qint64(DEFAULT_MEMORY_BUDGET_MB) << 20);
+    budget->loadUsage(QCoreApplication::applicationDirPath()+"/usage.json");
+
+    loudness = new LoudnessAnalyzer(this);
+    connect(loudness, &LoudnessAnalyzer::measured, this, &SoundboardDaemon::loudnessMeasured);
+
+    importer = new ImportPipeline(this);
+    connect(importer, &ImportPipeline::imported, this, &SoundboardDaemon::soundImported);
+    connect(importer, &ImportPipeline::finished, this, &SoundboardDaemon::importFinished);
+
+    watcher = new SoundWatcher(this);
+    connect(watcher, &SoundWatcher::filesChanged, this, &SoundboardDaemon::soundFilesChanged);
+
+    //other programs trigger sounds through the engine directly; the daemon only
+    //keeps the leds, the play counts and the banks in step
+    control = new ControlServer(audio, this);
+    connect(control, &ControlServer::played, this, [this](int slot){
+        if (slot >= slotCount || banks[currentBank].sounds[slot].isEmpty()) return;
+        budget->notePress(slot);
+        setLed(slot, true);
+    });
+    connect(control, &ControlServer::bankRequested, this, [this](int bank){
+        if (bank < banks.size()) switchBank(bank);
+    });
+    connect(control, &ControlServer::bankStepRequested, this, [this](int step){
+        switchBank(currentBank + step);
+    });
+
+    //the device, keys and MIDI controllers each play their presses on a thread
+    //of their own, as in the window; the leds and play counts catch up here
+    triggers = new TriggerQueue(audio, this);
+    connect(triggers, &TriggerQueue::pending, this, &SoundboardDaemon::handleTriggers);
+
+    //held combinations switch banks, as in the window
+    serialSource = new SerialSource(triggers, this);
+    serialSource->setLedTable(DEFAULT_SLOT_LEDS);
+    connect(serialSource, &SerialSource::buttonsSeen, this, [this](int buttons){
+        if (buttons > slotCount) setSlotCount(buttons);
+    });
+    connect(serialSource, &SerialSource::boardReported, this, [this](int buttons, const QList<int> &leds){
+        setSlotCount(buttons);
+        if (!leds.isEmpty()) serialSource->setLedTable(leds);
+    });
+    connect(serialSource, &SerialSource::bankStepRequested, this, [this](int step, const QList<int> &buttons){
+        for (int button : buttons) audio->stopSlot(button);
+        switchBank(currentBank + step);
+    });
+#ifdef Q_OS_LINUX
+    keySource = new EvdevSource(triggers, this);
+#endif
+#ifdef HAVE_ALSA
+    midiSource = new MidiSource(triggers, this);
+#endif
+
+    reconnectTimer = new QTimer(this);
+    reconnectTimer->setInterval(RECONNECT_INTERVAL_MS);
+    connect(reconnectTimer, &QTimer::timeout, this, &SoundboardDaemon::connectToSerialPort);
+
+    //there is nobody to click "Retry"; an unplugged device is looked for until it is back
+    connect(serialSource, &SerialSource::errorOccurred, this, [this](QSerialPort::SerialPortError error){
+        if (error == QSerialPort::NoError || !serialSource->isOpen()) return;
+        qWarning() << "Serial error on" << serialPort << error;
+        serialSource->close();
+        reconnectTimer->start();
+    });
+}
+
+SoundboardDaemon::~SoundboardDaemon(){
+    //their threads play through the engine, which would otherwise go first
+    delete control;
+    delete serialSource;
+#ifdef Q_OS_LINUX
+    delete keySource;
+#endif
+#ifdef HAVE_ALSA
+    delete midiSource;
+#endif
+    budget->saveUsage(QCoreApplication::applicationDirPath()+"/usage.json");
+}
+
+bool SoundboardDaemon::start(){
+    StartupProfile::begin("config load");
+    QJsonObject config;
+    const ConfigFile::Status status = ConfigFile::read(configFile, config);
+    if (status != ConfigFile::Status::Ok) {
+        qCritical() << (status == ConfigFile::Status::CannotOpen ? "Failed to open configuration file" : "Failed to parse configuration file") << configFile;
+        return false;
+    }
+    //the window upgrades configurations of older versions; the daemon never writes one
+    if (config["GLOBAL_PROGRAM_VERSION"].toString() != GLOBAL_PROGRAM_VERSION) {
+        qCritical() << configFile << "was created by a different version of this program; load it in the window once to upgrade it";
+        return false;
+    }
+    if (!config["sounds"].isArray()) {
+        qCritical() << "Configuration file" << configFile << "has no sounds";
+        return false;
+    }
+    applyConfig(config);
+    StartupProfile::end("config load");
+
+    StartupProfile::begin("audio start");
+    const bool started = audio->start();
+    StartupProfile::end("audio start");
+    if (!started) return false;
+    //the sounds are converted to the rate the streams opened at
+    SampleLoader::setTargetRate(audio->sampleRate());
+
+    StartupProfile::begin("sample cache warm");
+    loadBanks();
+    if (!importer->isBusy()) {
+        StartupProfile::end("sample cache warm");
+        StartupProfile::ready();
+    }
+    connectToSerialPort();
+    control->listen(controlName);
+#ifdef Q_OS_LINUX
+    keySource->start();
+#endif
+#ifdef HAVE_ALSA
+    midiSource->start();
+#endif
+
+#ifdef Q_OS_UNIX
+    //stop cleanly when asked to, so the play counts are saved and the streams closed
+    std::signal(SIGINT, [](int){ stopRequested = 1; });
+    std::signal(SIGTERM, [](int){ stopRequested = 1; });
+    QTimer *signalTimer = new QTimer(this);
+    connect(signalTimer, &QTimer::timeout, this, [](){
+        if (stopRequested) QCoreApplication::quit();
+    });
+    signalTimer->start(SIGNAL_POLL_MS);
+#endif
+
+    qDebug() << "Running" << configFile << "headless:" << banks.size() << "banks," << slotCount << "slots";
+    return true;
+}
+
+//the settings the window would apply for this configuration. missing keys
+//keep the window's defaults
+void SoundboardDaemon::applyConfig(const QJsonObject &config){
+    //what the sounds are decoded and measured with
+    SampleLoader::setResampleQuality(Resampler::Quality(qBound(0, config["resampleQuality"].toInt(Resampler::Best), 2)));
+    normalizeLoudness = config["normalizeLoudness"].toBool(true);
+    targetLufs = config["targetLufs"].toInt(DEFAULT_TARGET_LUFS);
+    silenceThresholdDb = config["silenceThresholdDb"].toInt(DEFAULT_SILENCE_THRESHOLD_DB);
+
+    //the banks (older configs have a single page, in "sounds" and "trims")
+    QJsonArray bankArray = config["banks"].toArray();
+    if (bankArray.isEmpty()) bankArray.append(QJsonObject{{"sounds", config["sounds"]}, {"trims", config["trims"]}});
+    banks.clear();
+    int sounds = DEFAULT_SLOT_COUNT;
+    for (const QJsonValue &value : std::as_const(bankArray)) {
+        const QJsonObject object = value.toObject();
+        Bank bank;
+        for (const QJsonValue &sound : object["sounds"].toArray()) bank.sounds.append(sound.toString());
+        const QJsonArray trimArray = object["trims"].toArray();
+        for (int i = 0; i < bank.sounds.size(); ++i) {
+            const QJsonArray trim = trimArray.at(i).toArray();
+            bank.trims.append(trim.size() == 2 ? QList<int>{trim[0].toInt(-1), trim[1].toInt(-1)} : QList<int>{-1, -1});
+        }
+        sounds = std::max<int>(sounds, bank.sounds.size());
+        banks.append(bank);
+    }
+    currentBank = qBound(0, config["currentBank"].toInt(), int(banks.size()) - 1);
+    setSlotCount(sounds);
+
+    //the buttons held together to switch banks, counting from 1
+    auto buttonList = [](const QJsonValue &value, const QList<int> &fallback) {
+        if (!value.isArray()) return fallback;
+        QList<int> buttons;
+        for (const QJsonValue &button : value.toArray()) buttons.append(button.toInt() - 1);
+        return buttons;
+    };
+    serialSource->setBankButtons(buttonList(config["prevBankButtons"], DEFAULT_PREV_BANK_BUTTONS),
+                                 buttonList(config["nextBankButtons"], DEFAULT_NEXT_BANK_BUTTONS));
+    serialPort = config["serialPort"].toString();
+
+    //the keys and the MIDI notes that trigger sounds
+#ifdef Q_OS_LINUX
+    QList<int> keys = DEFAULT_TRIGGER_KEYS;
+    if (config["triggerKeys"].isArray()) {
+        keys.clear();
+        for (const QJsonValue &key : config["triggerKeys"].toArray()) keys.append(key.toInt());
+    }
+    keySource->setKeys(keys);
+#endif
+#ifdef HAVE_ALSA
+    midiSource->setBaseNote(config["midiBaseNote"].toInt(DEFAULT_MIDI_BASE_NOTE));
+#endif
+
+    //the outputs, the microphone and the levels
+    const QList<QAudioDevice> outputs = QMediaDevices::audioOutputs();
+    audio->setOutputDevice(0, deviceName(outputs, config["outputDevice1Id"].toString()));
+    audio->setOutputDevice(1, deviceName(outputs, config["outputDevice2Id"].toString()));
+    audio->setInputDevice(deviceName(QMediaDevices::audioInputs(), config["inputDeviceId"].toString()));
+    audio->setMicBusEnabled(config["micBusEnabled"].toBool());
+    audio->setBusVolume(0, config["output1Volume"].toInt(DEFAULT_LEVEL) / 100.0f);
+    audio->setBusVolume(1, config["output2Volume"].toInt(DEFAULT_LEVEL) / 100.0f);
+    audio->setInputGain(config["inputGain"].toInt(DEFAULT_LEVEL) / 100.0f);
+    audio->setDuckingEnabled(config["duckingEnabled"].toBool());
+    audio->setDuckingAmount(-config["duckAmountDb"].toInt(DEFAULT_DUCK_DEPTH_DB));
+    audio->setDuckingTimes(config["duckAttackMs"].toInt(DEFAULT_DUCK_ATTACK), config["duckReleaseMs"].toInt(DEFAULT_DUCK_RELEASE));
+    audio->setGainRampTime(config["gainRampMs"].toInt(DEFAULT_GAIN_RAMP));
+    audio->setFadeTime(config["fadeMs"].toInt(DEFAULT_FADE));
+
+    //the gain of each sound on each output
+    const QJsonArray routeArray = config["routes"].toArray();
+    for (int i = 0; i < routeArray.size() && i < slotCount; ++i) {
+        const QJsonArray row = routeArray[i].toArray();
+        for (int bus = 0; bus < row.size() && bus < NUM_BUSES; ++bus)
+            audio->setRoute(i, bus, row[bus].toInt(DEFAULT_LEVEL) / 100.0f);
+    }
+}
+
+//grows the board to 'count' slots, like the window does when a device reports more buttons
+void SoundboardDaemon::setSlotCount(int count){
+    count = std::clamp(count, 1, MAX_SLOTS);
+    if (count <= slotCount) return;
+    slotCount = count;
+    for (Bank &bank : banks) {
+        bank.sounds.resize(count);
+        bank.trims.resize(count, QList<int>{-1, -1});
+        bank.samples.resize(count);
+        bank.gains.resize(count, 1.0f);
+    }
+
+    //slots the led table doesn't cover get leds of their own after the known ones
+    QList<int> leds = serialSource->ledTable();
+    int next = leds.isEmpty() ? 0 : *std::max_element(leds.begin(), leds.end()) + 1;
+    while (leds.size() < count) leds.append(next++);
+    if (leds != serialSource->ledTable()) serialSource->setLedTable(leds);
+}
+
+//hands the engine every slot of another bank at once; voices still playing finish as they were
+void SoundboardDaemon::switchBank(int bank){
+    if (banks.size() < 2) return;
+    bank = (bank % banks.size() + banks.size()) % banks.size();
+    if (bank == currentBank) return;
+
+    //the bank being left keeps its sounds, so switching back is instant as well
+    Bank &left = banks[currentBank];
+    for (int i = 0; i < slotCount; ++i) {
+        left.samples[i] = left.sounds[i].isEmpty() ? nullptr : audio->sample(i);
+        left.gains[i] = audio->slotGain(i);
+    }
+
+    Bank &target = banks[bank];
+    QVector<AudioManager::SlotState> states(slotCount);
+    for (int i = 0; i < slotCount; ++i) {
+        states[i].sample = target.samples[i];
+        if (states[i].sample && target.trims[i][0] >= 0 && target.trims[i][1] >= 0) {
+            states[i].trimStart = qint64(target.trims[i][0]) * states[i].sample->sampleRate / 1000;
+            states[i].trimEnd = qint64(target.trims[i][1]) * states[i].sample->sampleRate / 1000;
+        }
+        states[i].gain = target.gains[i];
+    }
+    audio->setSlots(states);
+    target.samples.fill(nullptr); //the engine holds them now
+    for (int i = 0; i < slotCount; ++i) budget->track(i, target.sounds[i]);
+    currentBank = bank;
+    qDebug() << "Switched to bank" << bank + 1;
+}
+
+//loads every sound of every bank that isn't loaded yet. the active bank starts
+//out as the memory budget decides, the others stream until they are switched to
+void SoundboardDaemon::loadBanks(){
+    QList<ImportPipeline::Job> jobs;
+    QStringList files;
+    for (int b = 0; b < banks.size(); ++b) {
+        const Bank &bank = banks[b];
+        for (int i = 0; i < bank.sounds.size(); ++i) {
+            if (bank.sounds[i].isEmpty()) continue;
+            files.append(bank.sounds[i]);
+            if (b != currentBank && bank.samples[i]) continue;
+            jobs.append(importJob(b, i));
+        }
+    }
+    importer->submit(jobs);
+    watcher->setFiles(files);
+}
+
+ImportPipeline::Job SoundboardDaemon::importJob(int bank, int slot) const{
+    ImportPipeline::Job job;
+    job.slot = slot;
+    job.bank = bank;
+    job.path = banks[bank].sounds[slot];
+    job.residency = bank == currentBank ? budget->initialResidency() : SampleLoader::Residency::Streaming;
+    job.findTrim = banks[bank].trims[slot][0] < 0 || banks[bank].trims[slot][1] < 0;
+    job.silenceThresholdDb = silenceThresholdDb;
+    return job;
+}
+
+//opens the device named in the configuration. until it is there, and after
+//it is unplugged, it is looked for again every few seconds
+void SoundboardDaemon::connectToSerialPort(){
+    if (serialPort.isEmpty() || serialSource->isOpen()) {
+        reconnectTimer->stop();
+        return;
+    }
+    //the source asks the device how many buttons it has and which led sits under each
+    QSerialPort::SerialPortError error = QSerialPort::NoError;
+    if (!serialSource->open(serialPort, BOARD_BAUD_RATE, &error)) {
+        if (!reconnectTimer->isActive()) qWarning() << "Failed to open serial port" << serialPort << error << "- retrying every" << RECONNECT_INTERVAL_MS << "ms";
+        reconnectTimer->start();
+        return;
+    }
+    reconnectTimer->stop();
+    qDebug() << "Connected to" << serialPort;
+}
+
+//the presses the trigger sources have played since this was last called
+void SoundboardDaemon::handleTriggers(){
+    for (const TriggerEvent &event : triggers->take()) soundTriggered(event.slot);
+}
+
+//a slot was triggered, and its sound (if it has one) is already playing
+void SoundboardDaemon::soundTriggered(int index){
+    if (index < 0 || index >= slotCount) return;
+    if (banks[currentBank].sounds[index].isEmpty()) {
+        qDebug() << "No sound on button" << index + 1 << "in bank" << currentBank + 1;
+        return;
+    }
+    budget->notePress(index);
+    setLed(index, true);
+}
+
+void SoundboardDaemon::soundEnd(int index){
+    setLed(index, false);
+}
+
+void SoundboardDaemon::setLed(int slot, bool on){
+    serialSource->setLed(slot, on);
+}
+
+//a sound finished loading; the active bank's go to the engine, the rest wait in their bank
+void SoundboardDaemon::soundImported(const ImportPipeline::Result &result){
+    if (result.bank < 0 || result.bank >= banks.size() || !result.sample) return;
+    Bank &bank = banks[result.bank];
+    const int index = result.slot;
+    if (index < 0 || index >= bank.sounds.size() || bank.sounds[index] != result.path) return;
+
+    if ((bank.trims[index][0] < 0 || bank.trims[index][1] < 0) && result.trimStart >= 0)
+        bank.trims[index] = detectedTrim(result);
+    if (result.bank == currentBank) {
+        budget->place(index, result.path, result.sample);
+        const int rate = result.sample->sampleRate;
+        if (bank.trims[index][0] >= 0 && bank.trims[index][1] >= 0)
+            audio->setTrim(index, qint64(bank.trims[index][0]) * rate / 1000, qint64(bank.trims[index][1]) * rate / 1000);
+        audio->setSlotGain(index, 1.0f);
+    } else {
+        bank.samples[index] = result.sample;
+        bank.gains[index] = 1.0f;
+    }
+    if (normalizeLoudness) loudness->analyze(index, result.path, result.sample, result.quality);
+}
+
+void SoundboardDaemon::importFinished(const QStringList &errors, qint64 elapsedMs){
+    qCDebug(lcTiming) << "Sounds ready in" << elapsedMs << "ms";
+    if (!StartupProfile::isReady()) {
+        StartupProfile::end("sample cache warm");
+        StartupProfile::ready();
+    }
+    if (!errors.isEmpty())
+        qWarning() << "Some sounds could not be loaded:" << errors;
+}
+
+//a sound's loudness was measured; bring it to the target level wherever it is used
+void SoundboardDaemon::loudnessMeasured(int slot, const QString &path, LoudnessAnalyzer::Measurement measurement){
+    if (!normalizeLoudness || slot < 0 || slot >= slotCount) return;
+    const float gain = LoudnessAnalyzer::normalizationGain(measurement, targetLufs);
+    for (int b = 0; b < banks.size(); ++b) {
+        if (banks[b].sounds[slot] != path) continue;
+        if (b == currentBank) audio->setSlotGain(slot, gain);
+        else banks[b].gains[slot] = gain;
+    }
+}
+
+//some sounds were changed on disk; load them again (and find their start and end points anew)
+void SoundboardDaemon::soundFilesChanged(const QStringList &paths){
+    QList<ImportPipeline::Job> jobs;
+    for (int b = 0; b < banks.size(); ++b) {
+        Bank &bank = banks[b];
+        for (int i = 0; i < bank.sounds.size(); ++i) {
+            if (!paths.contains(bank.sounds[i])) continue;
+            bank.trims[i] = {-1, -1};
+            bank.samples[i] = nullptr;
+            jobs.append(importJob(b, i));
+        }
+    }
+    importer->submit(jobs);
+}
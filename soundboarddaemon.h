@@ -0,0 +1,98 @@
+#ifndef SOUNDBOARDDAEMON_H
+#define SOUNDBOARDDAEMON_H
+
+#include "boardconfig.h"
+#include "audiomanager.h"
+#include "memorybudget.h"
+#include "loudnessanalyzer.h"
+#include "importpipeline.h"
+#include "soundwatcher.h"
+#include "serialsource.h"
+#include "controlserver.h"
+#ifdef Q_OS_LINUX
+#include "evdevsource.h"
+#endif
+#ifdef HAVE_ALSA
+#include "midisource.h"
+#endif
+
+#include <QJsonObject>
+#include <QStringList>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QList>
+
+// Plays a configuration with no window: the device, the import pipeline and
+// the audio engine, and nothing else. No widget, tray icon or dialog exists,
+// so it runs on a QCoreApplication, starts faster and needs a fraction of the
+// memory, which suits headless capture boxes and automated tests. Problems go
+// to the debug output instead of message boxes, and the configuration is only
+// ever read. Every bank is loaded up front (the inactive ones streaming from
+// the disk cache), so bank switches from the device are instant. Keys and
+// MIDI controllers trigger sounds as they do for the window.
+class SoundboardDaemon : public QObject
+{
+    Q_OBJECT
+public:
+    //'controlName': where other programs reach the control server
+    explicit SoundboardDaemon(const QString &configFile, const QString &controlName = CONTROL_SERVER_NAME, QObject *parent = nullptr);
+    ~SoundboardDaemon();
+
+    //reads the configuration, opens the outputs and starts loading the sounds;
+    //false if the configuration can't be used or no output could be opened
+    bool start();
+
+private slots:
+    void connectToSerialPort();
+    void handleTriggers();
+    void soundEnd(int index);
+    void soundImported(const ImportPipeline::Result &result);
+    void importFinished(const QStringList &errors, qint64 elapsedMs);
+    void loudnessMeasured(int slot, const QString &path, LoudnessAnalyzer::Measurement measurement);
+    void soundFilesChanged(const QStringList &paths);
+
+private:
+    //a page of sounds for the same buttons; the active one's samples live in the engine
+    struct Bank {
+        QStringList sounds;
+        QList<QList<int>> trims; // start/end points (ms), -1 until detected
+        QList<SamplePtr> samples;
+        QList<float> gains;
+    };
+
+    void applyConfig(const QJsonObject &config);
+    void setSlotCount(int count);
+    void switchBank(int bank);
+    void loadBanks();
+    ImportPipeline::Job importJob(int bank, int slot) const;
+    void soundTriggered(int index);
+    void setLed(int slot, bool on);
+
+    QString configFile, controlName;
+    QList<Bank> banks;
+    int currentBank = 0;
+    int slotCount = 0;
+    QString serialPort;
+    int silenceThresholdDb = DEFAULT_SILENCE_THRESHOLD_DB;
+    bool normalizeLoudness = true;
+    int targetLufs = DEFAULT_TARGET_LUFS;
+
+    AudioManager *audio;
+    MemoryBudget *budget;
+    LoudnessAnalyzer *loudness;
+    ImportPipeline *importer;
+    SoundWatcher *watcher;
+    ControlServer *control;
+    TriggerQueue *triggers;
+    SerialSource *serialSource;
+#ifdef Q_OS_LINUX
+    EvdevSource *keySource;
+#endif
+#ifdef HAVE_ALSA
+    MidiSource *midiSource;
+#endif
+    QTimer *reconnectTimer;
+};
+
+#endif // SOUNDBOARDDAEMON_H
@@ -3,6 +3,9 @@
 
 #include <QObject>
 #include <QWidget>
+#include <QList>
+
+#include <algorithm>
 
 #include "ui_Soundboard.h"
 
@@ -12,56 +15,88 @@ class SoundboardWidget : public QWidget
 public:
     explicit SoundboardWidget(QWidget *parent = nullptr) : QWidget(parent), ui(new Ui::SoundboardForm) {
         ui->setupUi(this);
-        //connect button presses
-        connect(ui->one,   &QPushButton::pressed,          this, [this](){emit buttonPressed(0);});
-        connect(ui->two,   &QPushButton::pressed,          this, [this](){emit buttonPressed(1);});
-        connect(ui->three, &QPushButton::pressed,          this, [this](){emit buttonPressed(2);});
-        connect(ui->four,  &QPushButton::pressed,          this, [this](){emit buttonPressed(3);});
-        connect(ui->five,  &QPushButton::pressed,          this, [this](){emit buttonPressed(4);});
-        connect(ui->six,   &QPushButton::pressed,          this, [this](){emit buttonPressed(5);});
-        connect(ui->seven, &QPushButton::pressed,          this, [this](){emit buttonPressed(6);});
-        connect(ui->eight, &QPushButton::pressed,          this, [this](){emit buttonPressed(7);});
-        connect(ui->nine,  &QPushButton::pressed,          this, [this](){emit buttonPressed(8);});
-        connect(ui->ten,   &QPushButton::pressed,          this, [this](){emit buttonPressed(9);});
-        //connect button right clicks
-        connect(ui->one,   &DroppableButton::rightClicked, this, [this](){emit buttonRightClicked(0);});
-        connect(ui->two,   &DroppableButton::rightClicked, this, [this](){emit buttonRightClicked(1);});
-        connect(ui->three, &DroppableButton::rightClicked, this, [this](){emit buttonRightClicked(2);});
-        connect(ui->four,  &DroppableButton::rightClicked, this, [this](){emit buttonRightClicked(3);});
-        connect(ui->five,  &DroppableButton::rightClicked, this, [this](){emit buttonRightClicked(4);});
-        connect(ui->six,   &DroppableButton::rightClicked, this, [this](){emit buttonRightClicked(5);});
-        connect(ui->seven, &DroppableButton::rightClicked, this, [this](){emit buttonRightClicked(6);});
-        connect(ui->eight, &DroppableButton::rightClicked, this, [this](){emit buttonRightClicked(7);});
-        connect(ui->nine,  &DroppableButton::rightClicked, this, [this](){emit buttonRightClicked(8);});
-        connect(ui->ten,   &DroppableButton::rightClicked, this, [this](){emit buttonRightClicked(9);});
-        //connect file drops
-        connect(ui->one,   &DroppableButton::fileDropped,  this, [this](const QString &filePath) {emit fileDropped(0, filePath);});
-        connect(ui->two,   &DroppableButton::fileDropped,  this, [this](const QString &filePath) {emit fileDropped(1, filePath);});
-        connect(ui->three, &DroppableButton::fileDropped,  this, [this](const QString &filePath) {emit fileDropped(2, filePath);});
-        connect(ui->four,  &DroppableButton::fileDropped,  this, [this](const QString &filePath) {emit fileDropped(3, filePath);});
-        connect(ui->five,  &DroppableButton::fileDropped,  this, [this](const QString &filePath) {emit fileDropped(4, filePath);});
-        connect(ui->six,   &DroppableButton::fileDropped,  this, [this](const QString &filePath) {emit fileDropped(5, filePath);});
-        connect(ui->seven, &DroppableButton::fileDropped,  this, [this](const QString &filePath) {emit fileDropped(6, filePath);});
-        connect(ui->eight, &DroppableButton::fileDropped,  this, [this](const QString &filePath) {emit fileDropped(7, filePath);});
-        connect(ui->nine,  &DroppableButton::fileDropped,  this, [this](const QString &filePath) {emit fileDropped(8, filePath);});
-        connect(ui->ten,   &DroppableButton::fileDropped,  this, [this](const QString &filePath) {emit fileDropped(9, filePath);});
+
+        //the form lays out one group of buttons (the original ten-button board);
+        //setSlotCount() continues its grid for bigger boards
+        buttons = {ui->one, ui->two, ui->three, ui->four, ui->five, ui->six, ui->seven, ui->eight, ui->nine, ui->ten};
+        groupSize = buttons.size();
+        for (int i = 0; i < buttons.size(); i++)
+            connectButton(i);
+        baseBorderHeight = ui->border->height();
+        baseLabelY = ui->label->y();
+        baseTableY = ui->tableWidget->y();
+        baseMinimumHeight = minimumHeight();
+        visibleSlots = buttons.size();
 
         //make the table read-only
         ui->tableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
     }
     ~SoundboardWidget() { delete ui; }
 
+    //show 'count' buttons and table rows, creating buttons as needed
+    void setSlotCount(int count){
+        while (buttons.size() < count) {
+            const int i = buttons.size();
+            DroppableButton *button = new DroppableButton(this);
+            button->setFont(ui->one->font());
+            button->setFixedSize(ui->one->size());
+            button->setToolTip(ui->one->toolTip());
+            button->setAcceptDrops(true);
+            button->setText(QString::number(i + 1));
+            button->move(position(i));
+            buttons.append(button);
+            connectButton(i);
+        }
+        for (int i = 0; i < buttons.size(); i++)
+            buttons[i]->setVisible(i < count);
+
+        //every further group of buttons pushes the table down by one group
+        const int extra = (std::max(1, (count + groupSize - 1) / groupSize) - 1) * groupHeight();
+        ui->border->resize(ui->border->width(), baseBorderHeight + extra);
+        ui->label->move(ui->label->x(), baseLabelY + extra);
+        ui->tableWidget->move(ui->tableWidget->x(), baseTableY + extra);
+        ui->tableWidget->setRowCount(count);
+        ui->tableWidget->setVerticalScrollBarPolicy(count > groupSize ? Qt::ScrollBarAsNeeded : Qt::ScrollBarAlwaysOff);
+        setMinimumHeight(baseMinimumHeight + extra);
+        visibleSlots = count;
+    }
+
+    int slotCount() const { return visibleSlots; }
+
     void setTableElement(int index, QString text){
         ui->tableWidget->setItem(index, 0, new QTableWidgetItem(text));
         ui->tableWidget->item(index, 0)->setToolTip(text);
     }
 
     QString getTableElement(int index){
-        return ui->tableWidget->item(index, 0)->text();
+        QTableWidgetItem *item = ui->tableWidget->item(index, 0);
+        return item ? item->text() : QString();
     }
 
 private:
     Ui::SoundboardForm *ui;
+    QList<DroppableButton *> buttons;
+    int groupSize, visibleSlots;
+    int baseBorderHeight, baseLabelY, baseTableY, baseMinimumHeight;
+
+    void connectButton(int index){
+        DroppableButton *button = buttons[index];
+        connect(button, &QPushButton::pressed,          this, [this, index](){emit buttonPressed(index);});
+        connect(button, &DroppableButton::rightClicked, this, [this, index](){emit buttonRightClicked(index);});
+        connect(button, &DroppableButton::fileDropped,  this, [this, index](const QString &filePath){emit fileDropped(index, filePath);});
+    }
+
+    //buttons run in columns of two, as on the board: 1 over 2, 3 over 4, ...
+    //and each further group of buttons starts a new pair of rows below
+    QPoint position(int index) const {
+        const int pitchX = ui->three->x() - ui->one->x();
+        const int pitchY = ui->two->y() - ui->one->y();
+        const int inGroup = index % groupSize;
+        return QPoint(ui->one->x() + (inGroup / 2) * pitchX,
+                      ui->one->y() + (inGroup % 2) * pitchY + (index / groupSize) * groupHeight());
+    }
+
+    int groupHeight() const { return 2 * (ui->two->y() - ui->one->y()); }
 signals:
     void buttonPressed(int);
     void buttonRightClicked(int);
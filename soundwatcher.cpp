@@ -0,0 +1,73 @@
+#include "soundwatcher.h"
+
+#include <QFileInfo>
+#include <QDebug>
+
+#define SETTLE_MS 300 // Quiet time after the last event before a file counts as saved
+
+SoundWatcher::SoundWatcher(QObject *parent) : QObject(parent)
+{
+    settleTimer.setSingleShot(true);
+    settleTimer.setInterval(SETTLE_MS);
+    connect(&settleTimer, &QTimer::timeout, this, &SoundWatcher::check);
+    connect(&watcher, &QFileSystemWatcher::fileChanged, &settleTimer, qOverload<>(&QTimer::start));
+    connect(&watcher, &QFileSystemWatcher::directoryChanged, &settleTimer, qOverload<>(&QTimer::start));
+}
+
+SoundWatcher::Stamp SoundWatcher::stamp(const QString &path){
+    const QFileInfo info(path);
+    Stamp result;
+    if (info.exists()) {
+        result.size = info.size();
+        result.modified = info.lastModified();
+    }
+    return result;
+}
+
+void SoundWatcher::setFiles(const QStringList &files){
+    QStringList paths, directories;
+    QHash<QString, Stamp> current;
+    for (const QString &file : files) {
+        if (file.isEmpty() || current.contains(file))
+            continue;
+        //keep what is already known so a change made while reloading isn't lost
+        current.insert(file, stamps.value(file, stamp(file)));
+        paths.append(file);
+        const QString directory = QFileInfo(file).absolutePath();
+        if (!directories.contains(directory))
+            directories.append(directory);
+    }
+    stamps = current;
+
+    if (!watcher.files().isEmpty())
+        watcher.removePaths(watcher.files());
+    if (!watcher.directories().isEmpty())
+        watcher.removePaths(watcher.directories());
+    if (!paths.isEmpty())
+        watcher.addPaths(paths);
+    if (!directories.isEmpty())
+        watcher.addPaths(directories);
+}
+
+void SoundWatcher::check(){
+    QStringList changed;
+    const QStringList watched = watcher.files();
+    for (auto it = stamps.begin(); it != stamps.end(); ++it) {
+        //a file that is gone may be mid-save; keep the old sound until it is back
+        if (!QFileInfo::exists(it.key()))
+            continue;
+        if (!watched.contains(it.key()))
+            watcher.addPath(it.key());
+
+        const Stamp now = stamp(it.key());
+        if (now == it.value())
+            continue;
+        it.value() = now;
+        changed.append(it.key());
+    }
+
+    if (!changed.isEmpty()) {
+        qDebug() << "Sound files changed on disk:" << changed;
+        emit filesChanged(changed);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef SOUNDWATCHER_H
+#define SOUNDWATCHER_H
+
+#include <QFileSystemWatcher>
+#include <QStringList>
+#include <QDateTime>
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+
+// Watches the assigned sound files and reports the ones whose contents have
+// changed on disk. Editors save in several writes, or by writing a temporary
+// file and renaming it over the original (which makes QFileSystemWatcher drop
+// the path), so events are coalesced and each file's size and modification
+// time decide whether it really changed. The containing directories are
+// watched as well, so a file replaced by a rename is picked up again.
+class SoundWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SoundWatcher(QObject *parent = nullptr);
+
+    //watch exactly these files (empty entries are ignored)
+    void setFiles(const QStringList &files);
+
+signals:
+    void filesChanged(const QStringList &paths);
+
+private slots:
+    void check();
+
+private:
+    struct Stamp {
+        qint64 size = -1;
+        QDateTime modified;
+        bool operator==(const Stamp &other) const { return size == other.size && modified == other.modified; }
+    };
+    static Stamp stamp(const QString &path);
+
+    QFileSystemWatcher watcher;
+    QHash<QString, Stamp> stamps;
+    QTimer settleTimer;
+};
+
+#endif // SOUNDWATCHER_H
@@ -0,0 +1,48 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// A fixed-capacity, wait-free single-producer/single-consumer ring buffer.
+// Used to pass commands and events between the control threads and the
+// real-time audio callback without locking or allocating on either side.
+// Capacity must be a power of two; one slot is always kept free.
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    //push an item; returns false if the queue is full
+    bool push(const T &item) {
+        const std::size_t head = writeIndex.load(std::memory_order_relaxed);
+        const std::size_t next = (head + 1) & (Capacity - 1);
+        if (next == readIndex.load(std::memory_order_acquire))
+            return false;
+        items[head] = item;
+        writeIndex.store(next, std::memory_order_release);
+        return true;
+    }
+
+    //pop an item; returns false if the queue is empty
+    bool pop(T &item) {
+        const std::size_t tail = readIndex.load(std::memory_order_relaxed);
+        if (tail == writeIndex.load(std::memory_order_acquire))
+            return false;
+        item = items[tail];
+        readIndex.store((tail + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const {
+        return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+    }
+
+private:
+    T items[Capacity];
+    alignas(64) std::atomic<std::size_t> writeIndex{0};
+    alignas(64) std::atomic<std::size_t> readIndex{0};
+};
+
+#endif // SPSCQUEUE_H
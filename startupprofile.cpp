@@ -0,0 +1,90 @@
+#include "startupprofile.h"
+#include "soundboard.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QFile>
+#include <QDebug>
+
+#define TIME_TO_READY_BUDGET_MS 1500 // Startups slower than this are logged as over budget
+#define PROFILE_RUNS 20              // Runs kept in startup.json
+
+Q_LOGGING_CATEGORY(lcTiming, "usbsoundboard.timing", QtInfoMsg)
+
+QMutex StartupProfile::mutex;
+QElapsedTimer StartupProfile::clock;
+QList<StartupProfile::Phase> StartupProfile::phases;
+bool StartupProfile::done = false;
+
+void StartupProfile::start(){
+    QMutexLocker locker(&mutex);
+    clock.start();
+}
+
+void StartupProfile::begin(const QString &phase){
+    QMutexLocker locker(&mutex);
+    if (done || !clock.isValid())
+        return;
+    phases.append({phase, clock.elapsed(), -1});
+}
+
+void StartupProfile::end(const QString &phase){
+    QMutexLocker locker(&mutex);
+    if (done || !clock.isValid())
+        return;
+    for (Phase &p : phases) {
+        if (p.name == phase && p.ms < 0) {
+            p.ms = clock.elapsed() - p.startMs;
+            qDebug() << "Startup:" << phase << "took" << p.ms << "ms";
+            return;
+        }
+    }
+}
+
+bool StartupProfile::isReady(){
+    QMutexLocker locker(&mutex);
+    return done;
+}
+
+void StartupProfile::ready(){
+    QMutexLocker locker(&mutex);
+    if (done || !clock.isValid())
+        return;
+    done = true;
+    const qint64 total = clock.elapsed();
+    if (total > TIME_TO_READY_BUDGET_MS)
+        qWarning() << "Startup: ready after" << total << "ms, over the" << TIME_TO_READY_BUDGET_MS << "ms budget";
+    else
+        qDebug() << "Startup: ready after" << total << "ms";
+
+    QJsonArray phaseArray;
+    for (const Phase &p : std::as_const(phases))
+        phaseArray.append(QJsonObject{{"name", p.name}, {"startMs", p.startMs}, {"ms", p.ms}});
+    const QJsonObject run{
+        {"version", GLOBAL_PROGRAM_VERSION},
+        {"date", QDateTime::currentDateTime().toString(Qt::ISODate)},
+        {"timeToReadyMs", total},
+        {"budgetMs", TIME_TO_READY_BUDGET_MS},
+        {"phases", phaseArray}
+    };
+
+    //keep the latest runs, newest last
+    const QString fileName = QCoreApplication::applicationDirPath() + "/startup.json";
+    QJsonArray runs;
+    QFile in(fileName);
+    if (in.open(QIODevice::ReadOnly))
+        runs = QJsonDocument::fromJson(in.readAll()).object()["runs"].toArray();
+    runs.append(run);
+    while (runs.size() > PROFILE_RUNS)
+        runs.removeFirst();
+
+    QSaveFile out(fileName);
+    if (out.open(QIODevice::WriteOnly)) {
+        out.write(QJsonDocument(QJsonObject{{"runs", runs}}).toJson());
+        out.commit();
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef STARTUPPROFILE_H
+#define STARTUPPROFILE_H
+
+#include <QLoggingCategory>
+#include <QElapsedTimer>
+#include <QString>
+#include <QMutex>
+#include <QList>
+
+// Per-sound and per-batch timings and notes (decodes, cache hits, shared
+// sounds, loudness measurements, config reads, bank switches, memory budget
+// plans). Off by default; run with
+// QT_LOGGING_RULES="usbsoundboard.timing.debug=true" to see them.
+Q_DECLARE_LOGGING_CATEGORY(lcTiming)
+
+// Timings of the phases of startup, measured from the start of main(). Phases
+// can overlap (some run on other threads while the window is already up), so
+// each one records when it began and how long it took. When the board is
+// ready to use, the run is logged and added to startup.json next to init.json,
+// which keeps the most recent runs so the time to ready can be tracked from
+// one release to the next.
+class StartupProfile
+{
+public:
+    //start the clock; as early in main() as possible
+    static void start();
+
+    //mark the beginning and end of a phase; safe on any thread
+    static void begin(const QString &phase);
+    static void end(const QString &phase);
+
+    //the board is usable (window up, audio running, startup sounds loaded); writes the profile once
+    static void ready();
+    static bool isReady();
+
+private:
+    struct Phase {
+        QString name;
+        qint64 startMs = 0;
+        qint64 ms = -1; // -1 while running
+    };
+
+    static QMutex mutex;
+    static QElapsedTimer clock;
+    static QList<Phase> phases;
+    static bool done;
+};
+
+#endif // STARTUPPROFILE_H
@@ -0,0 +1,97 @@
+#include "triggersource.h"
+
+#include <QDebug>
+
+#include <chrono>
+
+#ifdef Q_OS_LINUX
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#define MAX_PENDING_TRIGGERS 256 // Presses kept for an owner that doesn't get to them (they have played already)
+#define SLOW_TRIGGER_MS 50 // Presses the owner only got to after this long are logged
+
+TriggerQueue::TriggerQueue(AudioManager *audio, QObject *parent)
+    : QObject(parent), audio(audio)
+{
+}
+
+qint64 TriggerQueue::now(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TriggerQueue::push(const TriggerEvent &event){
+    audio->play(event.slot, event.velocity);
+
+    QMutexLocker locker(&mutex);
+    const bool wasEmpty = events.isEmpty();
+    if (events.size() >= MAX_PENDING_TRIGGERS)
+        events.removeFirst();
+    events.append(event);
+    locker.unlock();
+
+    if (wasEmpty)
+        emit pending();
+}
+
+QList<TriggerEvent> TriggerQueue::take(){
+    QMutexLocker locker(&mutex);
+    QList<TriggerEvent> taken;
+    taken.swap(events);
+    locker.unlock();
+
+    const qint64 time = now();
+    for (const TriggerEvent &event : std::as_const(taken)) {
+        const qint64 lateMs = (time - event.timestamp) / 1000000;
+        if (lateMs > SLOW_TRIGGER_MS)
+            qDebug() << "Press of slot" << event.slot + 1 << "from" << event.source << "handled" << lateMs << "ms after it happened";
+    }
+    return taken;
+}
+
+TriggerSource::TriggerSource(const QString &name, TriggerQueue *queue, QObject *parent)
+    : QThread(parent), name(name), queue(queue)
+{
+    setObjectName(name);
+#ifdef Q_OS_LINUX
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+}
+
+TriggerSource::~TriggerSource(){
+    stop();
+#ifdef Q_OS_LINUX
+    if (wakeFd >= 0)
+        ::close(wakeFd);
+#endif
+}
+
+const QString &TriggerSource::sourceName() const {
+    return name;
+}
+
+void TriggerSource::stop(){
+    if (!isRunning())
+        return;
+    requestInterruption();
+    quit();
+#ifdef Q_OS_LINUX
+    const quint64 one = 1;
+    if (wakeFd >= 0 && ::write(wakeFd, &one, sizeof(one)) < 0)
+        qDebug() << "Failed to wake trigger source" << name;
+#endif
+    wait();
+}
+
+void TriggerSource::trigger(int slot, float velocity, qint64 timestamp){
+    if (slot < 0 || slot >= MAX_SLOTS)
+        return;
+    queue->push({timestamp, slot, velocity, name});
+}
+
+#ifdef Q_OS_LINUX
+int TriggerSource::stopFd() const {
+    return wakeFd;
+}
+#endif
@@ -0,0 +1,86 @@
+#ifndef TRIGGERSOURCE_H
+#define TRIGGERSOURCE_H
+
+#include "audiomanager.h"
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QMutex>
+#include <QList>
+
+// A press from one of the trigger sources.
+struct TriggerEvent {
+    qint64 timestamp;   // when the input happened, in ns on TriggerQueue::now()'s clock
+    int slot;
+    float velocity;     // gain of the voice, 0..1; 1 for plain buttons
+    QString source;
+};
+
+// The one queue every trigger source feeds. A press is played as soon as it
+// is pushed, on the source's own thread (the engine only queues a command),
+// and then waits here with its timestamp until the owner gets to the rest
+// (leds, play counts) on its thread. A busy window delays the led, never the
+// sound.
+class TriggerQueue : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TriggerQueue(AudioManager *audio, QObject *parent = nullptr);
+
+    // The monotonic clock the events are stamped on (CLOCK_MONOTONIC on Linux,
+    // the clock evdev stamps its events with once asked to).
+    static qint64 now();
+
+    // Any thread: plays the press and queues it.
+    void push(const TriggerEvent &event);
+
+    // Owner thread: the presses queued since the last call, oldest first.
+    QList<TriggerEvent> take();
+
+signals:
+    // Emitted by the pushing thread when the queue stops being empty, so the
+    // owner is woken once per batch.
+    void pending();
+
+private:
+    AudioManager *audio;
+    QMutex mutex;
+    QList<TriggerEvent> events;
+};
+
+// An input that triggers sounds, read on a thread of its own: the serial
+// device, keyboards and pads, MIDI controllers. Sources that wait on file
+// descriptors override run() and also poll stopFd(); the others run the
+// thread's event loop. Subclasses call stop() in their destructors, before
+// anything run() uses is gone.
+class TriggerSource : public QThread
+{
+    Q_OBJECT
+public:
+    TriggerSource(const QString &name, TriggerQueue *queue, QObject *parent = nullptr);
+    ~TriggerSource();
+
+    const QString &sourceName() const;
+
+    // Ends run() and waits for the thread. A stopped source isn't started again.
+    void stop();
+
+protected:
+    // Source thread: plays 'slot' and queues the press for the owner.
+    void trigger(int slot, float velocity = 1.0f, qint64 timestamp = TriggerQueue::now());
+
+#ifdef Q_OS_LINUX
+    // Readable once stop() has been called.
+    int stopFd() const;
+#endif
+
+private:
+    QString name;
+    TriggerQueue *queue;
+#ifdef Q_OS_LINUX
+    int wakeFd = -1;
+#endif
+};
+
+#endif // TRIGGERSOURCE_H